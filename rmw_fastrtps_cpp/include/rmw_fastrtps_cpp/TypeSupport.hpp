@@ -50,6 +50,9 @@ protected:
 private:
   const message_type_support_callbacks_t * members_;
   bool has_data_;
+  // Size of the messages which are laid out in memory as in CDR, and so can be serialized and
+  // deserialized with a single copy when the endianness of the host is used, 0 for other types.
+  size_t plain_size_;
 };
 
 }  // namespace rmw_fastrtps_cpp
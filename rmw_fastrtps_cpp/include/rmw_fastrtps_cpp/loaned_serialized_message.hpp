@@ -0,0 +1,66 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_CPP__LOANED_SERIALIZED_MESSAGE_HPP_
+#define RMW_FASTRTPS_CPP__LOANED_SERIALIZED_MESSAGE_HPP_
+
+#include "rmw/rmw.h"
+#include "rmw_fastrtps_cpp/visibility_control.h"
+
+namespace rmw_fastrtps_cpp
+{
+
+/// Take a message in its serialized form, without deserializing it.
+/**
+ * Only supported for subscriptions to types which are not plain; messages of plain types can
+ * be loaned with rmw_take_loaned_message() instead.
+ * See rmw_fastrtps_shared_cpp::__rmw_take_loaned_serialized_message() for details.
+ *
+ * \param[in] subscription the subscription to take from
+ * \param[out] loaned_message the serialized message loaned, if one was taken
+ * \param[out] taken whether a message was taken
+ * \param[out] message_info information about the message taken, may be `NULL`
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is invalid, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the subscription is from another
+ *   implementation, or
+ * \return `RMW_RET_UNSUPPORTED` if the type of the subscription is plain.
+ */
+RMW_FASTRTPS_CPP_PUBLIC
+rmw_ret_t
+take_loaned_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info);
+
+/// Return a serialized message loaned by take_loaned_serialized_message().
+/**
+ * \param[in] subscription the subscription the message was taken from
+ * \param[in] loaned_message the serialized message to return
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is invalid, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the subscription is from another
+ *   implementation, or
+ * \return `RMW_RET_ERROR` if the message was not loaned by this subscription.
+ */
+RMW_FASTRTPS_CPP_PUBLIC
+rmw_ret_t
+return_loaned_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * loaned_message);
+
+}  // namespace rmw_fastrtps_cpp
+
+#endif  // RMW_FASTRTPS_CPP__LOANED_SERIALIZED_MESSAGE_HPP_
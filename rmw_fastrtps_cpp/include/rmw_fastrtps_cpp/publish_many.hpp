@@ -0,0 +1,52 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_CPP__PUBLISH_MANY_HPP_
+#define RMW_FASTRTPS_CPP__PUBLISH_MANY_HPP_
+
+#include "rmw/rmw.h"
+#include "rmw_fastrtps_cpp/visibility_control.h"
+
+namespace rmw_fastrtps_cpp
+{
+
+/// Publish several messages at once.
+/**
+ * Same as calling rmw_publish() for each message in order, checking and looking up the
+ * publisher only once.
+ * See rmw_fastrtps_shared_cpp::__rmw_publish_many() for details.
+ *
+ * \param[in] publisher the publisher to publish the messages with
+ * \param[in] ros_messages array of `count` messages to publish
+ * \param[in] count number of messages to publish
+ * \param[out] published number of messages published
+ * \param[in] allocation publisher allocation, may be `NULL`
+ * \return `RMW_RET_OK` if all the messages were published, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is invalid, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the publisher is from another
+ *   implementation, or
+ * \return `RMW_RET_ERROR` if a message could not be published.
+ */
+RMW_FASTRTPS_CPP_PUBLIC
+rmw_ret_t
+publish_many(
+  const rmw_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation);
+
+}  // namespace rmw_fastrtps_cpp
+
+#endif  // RMW_FASTRTPS_CPP__PUBLISH_MANY_HPP_
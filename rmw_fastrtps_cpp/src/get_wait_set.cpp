@@ -0,0 +1,68 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_fastrtps_cpp/get_wait_set.hpp"
+
+#include "rmw/error_handling.h"
+
+#include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
+#include "rmw_fastrtps_cpp/identifier.hpp"
+
+namespace rmw_fastrtps_cpp
+{
+
+int
+get_wait_set_fd(rmw_wait_set_t * wait_set)
+{
+  if (!wait_set) {
+    return -1;
+  }
+  if (wait_set->implementation_identifier != eprosima_fastrtps_identifier) {
+    return -1;
+  }
+  int fd = -1;
+  if (rmw_fastrtps_shared_cpp::__rmw_wait_set_get_fd(
+      eprosima_fastrtps_identifier, wait_set, &fd) != RMW_RET_OK)
+  {
+    rmw_reset_error();
+    return -1;
+  }
+  return fd;
+}
+
+rmw_ret_t
+set_wait_set_spin_period(rmw_wait_set_t * wait_set, const rmw_time_t * spin_period)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_wait_set_set_spin_period(
+    eprosima_fastrtps_identifier, wait_set, spin_period);
+}
+
+rmw_ret_t
+get_wait_set_wakeup_counts(
+  const rmw_wait_set_t * wait_set,
+  uint64_t * spin_wakeups,
+  uint64_t * block_wakeups)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_wait_set_get_wakeup_counts(
+    eprosima_fastrtps_identifier, wait_set, spin_wakeups, block_wakeups);
+}
+
+rmw_ret_t
+get_wait_set_suppressed_notification_count(const rmw_wait_set_t * wait_set, uint64_t * count)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_wait_set_get_suppressed_notification_count(
+    eprosima_fastrtps_identifier, wait_set, count);
+}
+
+}  // namespace rmw_fastrtps_cpp
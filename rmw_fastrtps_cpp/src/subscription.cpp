@@ -37,6 +37,7 @@
 
 #include "rcpputils/scope_exit.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_participant_info.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_subscriber_info.hpp"
 #include "rmw_fastrtps_shared_cpp/names.hpp"
@@ -282,6 +283,22 @@ create_subscription(
     return nullptr;
   }
 
+  if (!participant_info->leave_middleware_default_qos &&
+    participant_info->data_sharing_mode != data_sharing_mode_t::OFF)
+  {
+    enable_data_sharing_if_supported(
+      info->type_support_, topic_name,
+      participant_info->data_sharing_mode == data_sharing_mode_t::AUTO,
+      participant_info->data_sharing_domain_ids, reader_qos);
+  }
+
+  // Content filters cannot be evaluated on compressed payloads
+  if (nullptr != info->filtered_topic_) {
+    rmw_fastrtps_shared_cpp::withdraw_decompression(reader_qos);
+  } else if (rmw_fastrtps_shared_cpp::advertise_decompression(reader_qos)) {
+    info->decompressing_readers_ = participant_info->decompressing_readers_;
+  }
+
   info->datareader_qos_ = reader_qos;
 
   // create_datareader
@@ -308,6 +325,10 @@ create_subscription(
   info->subscription_gid_ = rmw_fastrtps_shared_cpp::create_rmw_gid(
     eprosima_fastrtps_identifier, info->data_reader_->guid());
 
+  if (info->decompressing_readers_) {
+    info->decompressing_readers_->add(info->data_reader_->guid());
+  }
+
   /////
   // Allocate subscription
   rmw_subscription_t * rmw_subscription = rmw_subscription_allocate();
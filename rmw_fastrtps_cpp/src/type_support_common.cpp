@@ -28,6 +28,8 @@ TypeSupport::TypeSupport()
   m_isGetKeyDefined = false;
   max_size_bound_ = false;
   is_plain_ = false;
+  has_data_ = false;
+  plain_size_ = 0;
 }
 
 void TypeSupport::set_members(const message_type_support_callbacks_t * members)
@@ -39,6 +41,9 @@ void TypeSupport::set_members(const message_type_support_callbacks_t * members)
   auto data_size = static_cast<uint32_t>(members->max_serialized_size(bounds_info));
   max_size_bound_ = 0 != (bounds_info & ROSIDL_TYPESUPPORT_FASTRTPS_BOUNDED_TYPE);
   is_plain_ = bounds_info == ROSIDL_TYPESUPPORT_FASTRTPS_PLAIN_TYPE;
+  // The typesupport only reports a type as plain when its members are at the same offsets in
+  // memory and in CDR, so that its serialized form is its first data_size bytes.
+  plain_size_ = is_plain_ ? data_size : 0;
 #else
   is_plain_ = true;
   auto data_size = static_cast<uint32_t>(members->max_serialized_size(is_plain_));
@@ -85,6 +90,10 @@ bool TypeSupport::serializeROSmessage(
 
   // If type is not empty, serialize message
   if (has_data_) {
+    if (plain_size_ > 0 && ser.endianness() == eprosima::fastcdr::Cdr::DEFAULT_ENDIAN) {
+      ser.serializeArray(static_cast<const uint8_t *>(ros_message), plain_size_);
+      return true;
+    }
     auto callbacks = static_cast<const message_type_support_callbacks_t *>(impl);
     return callbacks->cdr_serialize(ros_message, ser);
   }
@@ -106,6 +115,11 @@ bool TypeSupport::deserializeROSmessage(
 
     // If type is not empty, deserialize message
     if (has_data_) {
+      // Messages with another endianness have each of their fields swapped by the typesupport
+      if (plain_size_ > 0 && deser.endianness() == eprosima::fastcdr::Cdr::DEFAULT_ENDIAN) {
+        deser.deserializeArray(static_cast<uint8_t *>(ros_message), plain_size_);
+        return true;
+      }
       auto callbacks = static_cast<const message_type_support_callbacks_t *>(impl);
       return callbacks->cdr_deserialize(deser, ros_message);
     }
@@ -0,0 +1,189 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <thread>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/env.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+// Deliver through the transports (0) or through intra-participant data-sharing (1).
+void
+delivery_args(benchmark::internal::Benchmark * b)
+{
+  b->Arg(0);
+  b->Arg(1);
+  b->ArgNames({"intra_participant"});
+}
+
+}  // namespace
+
+class IntraParticipantPerformanceTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    const char * data_sharing = st.range(0) ? "INTRA_PARTICIPANT" : "OFF";
+    if (!rcutils_set_env("RMW_FASTRTPS_DATA_SHARING", data_sharing) || !create_entities()) {
+      skip(st);
+    }
+
+    test_msgs__msg__BasicTypes__init(&sent);
+    test_msgs__msg__BasicTypes__init(&received);
+
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    test_msgs__msg__BasicTypes__fini(&received);
+    test_msgs__msg__BasicTypes__fini(&sent);
+    if (nullptr != subscription) {
+      rmw_destroy_subscription(node, subscription);
+      subscription = nullptr;
+    }
+    if (nullptr != publisher) {
+      rmw_destroy_publisher(node, publisher);
+      publisher = nullptr;
+    }
+    if (nullptr != node) {
+      rmw_destroy_node(node);
+      node = nullptr;
+    }
+    if (nullptr != context.impl) {
+      rmw_shutdown(&context);
+      rmw_context_fini(&context);
+    }
+    context = rmw_get_zero_initialized_context();
+    rcutils_set_env("RMW_FASTRTPS_DATA_SHARING", nullptr);
+  }
+
+protected:
+  bool create_entities()
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    if (RMW_RET_OK != rmw_init_options_init(&options, rcutils_get_default_allocator())) {
+      return false;
+    }
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    rmw_ret_t ret = rmw_init(&options, &context);
+    rmw_init_options_fini(&options);
+    if (RMW_RET_OK != ret) {
+      return false;
+    }
+    node = rmw_create_node(&context, "benchmark_intra_participant", "/");
+    if (nullptr == node) {
+      return false;
+    }
+
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    constexpr char topic_name[] = "/benchmark_intra_participant";
+    rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    publisher = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+    if (nullptr == publisher) {
+      return false;
+    }
+    rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+    subscription = rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+    if (nullptr == subscription) {
+      return false;
+    }
+    return wait_for_match();
+  }
+
+  bool wait_for_match()
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      size_t count = 0;
+      if (RMW_RET_OK != rmw_subscription_count_matched_publishers(subscription, &count)) {
+        return false;
+      }
+      if (count > 0) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    RMW_SET_ERROR_MSG("publisher and subscription did not match");
+    return false;
+  }
+
+  // Spin on rmw_take, so that waiting does not weigh on the measured delivery time.
+  bool take_one()
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    bool taken = false;
+    while (!taken) {
+      if (RMW_RET_OK != rmw_take(subscription, &received, &taken, nullptr)) {
+        return false;
+      }
+      if (!taken && std::chrono::steady_clock::now() > deadline) {
+        RMW_SET_ERROR_MSG("published message was not received");
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void skip(benchmark::State & st)
+  {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+  }
+
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_publisher_t * publisher{nullptr};
+  rmw_subscription_t * subscription{nullptr};
+  test_msgs__msg__BasicTypes sent;
+  test_msgs__msg__BasicTypes received;
+};
+
+BENCHMARK_DEFINE_F(IntraParticipantPerformanceTest, publish_take)(benchmark::State & st)
+{
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    ++sent.int64_value;
+    if (RMW_RET_OK != rmw_publish(publisher, &sent, nullptr)) {
+      skip(st);
+      break;
+    }
+    if (!take_one()) {
+      skip(st);
+      break;
+    }
+    if (received.int64_value != sent.int64_value) {
+      st.SkipWithError("received an unexpected message");
+      break;
+    }
+  }
+}
+BENCHMARK_REGISTER_F(IntraParticipantPerformanceTest, publish_take)->Apply(delivery_args);
@@ -0,0 +1,172 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_fastrtps_cpp/publish_many.hpp"
+
+#include "test_msgs/msg/basic_types.h"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+// Publish batches of 1 to 1000 messages.
+void
+batch_args(benchmark::internal::Benchmark * b)
+{
+  for (int64_t batch_size : {1, 10, 100, 1000}) {
+    b->Arg(batch_size);
+  }
+  b->ArgNames({"batch"});
+}
+
+}  // namespace
+
+class PublishManyPerformanceTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    if (!create_entities()) {
+      skip(st);
+    }
+
+    const size_t batch_size = static_cast<size_t>(st.range(0));
+    messages.resize(batch_size);
+    message_ptrs.resize(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      test_msgs__msg__BasicTypes__init(&messages[i]);
+      messages[i].int64_value = static_cast<int64_t>(i);
+      message_ptrs[i] = &messages[i];
+    }
+
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    for (auto & message : messages) {
+      test_msgs__msg__BasicTypes__fini(&message);
+    }
+    messages.clear();
+    if (nullptr != subscription) {
+      rmw_destroy_subscription(node, subscription);
+      subscription = nullptr;
+    }
+    if (nullptr != publisher) {
+      rmw_destroy_publisher(node, publisher);
+      publisher = nullptr;
+    }
+    if (nullptr != node) {
+      rmw_destroy_node(node);
+      node = nullptr;
+    }
+    if (nullptr != context.impl) {
+      rmw_shutdown(&context);
+      rmw_context_fini(&context);
+    }
+    context = rmw_get_zero_initialized_context();
+  }
+
+protected:
+  bool create_entities()
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    if (RMW_RET_OK != rmw_init_options_init(&options, rcutils_get_default_allocator())) {
+      return false;
+    }
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    rmw_ret_t ret = rmw_init(&options, &context);
+    rmw_init_options_fini(&options);
+    if (RMW_RET_OK != ret) {
+      return false;
+    }
+    node = rmw_create_node(&context, "benchmark_publish_many", "/");
+    if (nullptr == node) {
+      return false;
+    }
+
+    // A subscription is matched so that the messages are actually sent.
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    constexpr char topic_name[] = "/benchmark_publish_many";
+    rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+    qos_profile.reliability = RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT;
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    publisher = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+    if (nullptr == publisher) {
+      return false;
+    }
+    rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+    subscription = rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+    return nullptr != subscription;
+  }
+
+  void skip(benchmark::State & st)
+  {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+  }
+
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_publisher_t * publisher{nullptr};
+  rmw_subscription_t * subscription{nullptr};
+  std::vector<test_msgs__msg__BasicTypes> messages;
+  std::vector<const void *> message_ptrs;
+};
+
+BENCHMARK_DEFINE_F(PublishManyPerformanceTest, publish_loop)(benchmark::State & st)
+{
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    for (const void * message : message_ptrs) {
+      if (RMW_RET_OK != rmw_publish(publisher, message, nullptr)) {
+        skip(st);
+        break;
+      }
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(message_ptrs.size()));
+}
+BENCHMARK_REGISTER_F(PublishManyPerformanceTest, publish_loop)->Apply(batch_args);
+
+BENCHMARK_DEFINE_F(PublishManyPerformanceTest, publish_many)(benchmark::State & st)
+{
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    size_t published = 0;
+    rmw_ret_t ret = rmw_fastrtps_cpp::publish_many(
+      publisher, message_ptrs.data(), message_ptrs.size(), &published, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip(st);
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(message_ptrs.size()));
+}
+BENCHMARK_REGISTER_F(PublishManyPerformanceTest, publish_many)->Apply(batch_args);
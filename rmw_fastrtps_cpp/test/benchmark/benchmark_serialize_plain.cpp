@@ -0,0 +1,256 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "fastcdr/Cdr.h"
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+#include "rmw/serialized_message.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_typesupport_fastrtps_cpp/identifier.hpp"
+#include "rosidl_typesupport_fastrtps_cpp/message_type_support.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+// Message made of large fixed-size arrays, laid out in memory as in CDR.
+template<size_t N>
+struct FixedArrays
+{
+  int32_t int32_values[N];
+  double float64_values[N];
+};
+
+// Hand-written typesupport for FixedArrays, serializing it field by field like the generated
+// ones, and reporting it as plain or only as bounded to compare both serialization paths.
+template<size_t N, bool Plain>
+struct FixedArraysTypeSupport
+{
+  using Message = FixedArrays<N>;
+
+  static bool
+  cdr_serialize(const void * untyped_ros_message, eprosima::fastcdr::Cdr & cdr)
+  {
+    auto ros_message = static_cast<const Message *>(untyped_ros_message);
+    cdr.serializeArray(ros_message->int32_values, N);
+    cdr.serializeArray(ros_message->float64_values, N);
+    return true;
+  }
+
+  static bool
+  cdr_deserialize(eprosima::fastcdr::Cdr & cdr, void * untyped_ros_message)
+  {
+    auto ros_message = static_cast<Message *>(untyped_ros_message);
+    cdr.deserializeArray(ros_message->int32_values, N);
+    cdr.deserializeArray(ros_message->float64_values, N);
+    return true;
+  }
+
+  static uint32_t
+  get_serialized_size(const void *)
+  {
+    return static_cast<uint32_t>(N * (sizeof(int32_t) + sizeof(double)));
+  }
+
+#ifdef ROSIDL_TYPESUPPORT_FASTRTPS_HAS_PLAIN_TYPES
+  static size_t
+  max_serialized_size(char & bounds_info)
+  {
+    bounds_info = Plain ?
+      ROSIDL_TYPESUPPORT_FASTRTPS_PLAIN_TYPE : ROSIDL_TYPESUPPORT_FASTRTPS_BOUNDED_TYPE;
+    return N * (sizeof(int32_t) + sizeof(double));
+  }
+#else
+  static size_t
+  max_serialized_size(bool & full_bounded)
+  {
+    full_bounded = true;
+    return N * (sizeof(int32_t) + sizeof(double));
+  }
+#endif
+
+  static const rosidl_message_type_support_t *
+  get()
+  {
+    static const message_type_support_callbacks_t callbacks = {
+      "benchmark",
+      "FixedArrays",
+      cdr_serialize,
+      cdr_deserialize,
+      get_serialized_size,
+      max_serialized_size
+    };
+    static const rosidl_message_type_support_t type_support = {
+      rosidl_typesupport_fastrtps_cpp::typesupport_identifier,
+      &callbacks,
+      get_message_typesupport_handle_function,
+    };
+    return &type_support;
+  }
+};
+
+}  // namespace
+
+class SerializePlainPerformanceTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    serialized_message = rmw_get_zero_initialized_serialized_message();
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    if (RMW_RET_OK != rmw_serialized_message_init(&serialized_message, 0u, &allocator)) {
+      skip(st);
+    }
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    rmw_serialized_message_fini(&serialized_message);
+  }
+
+protected:
+  void serialize(
+    benchmark::State & st, const void * ros_message,
+    const rosidl_message_type_support_t * type_support)
+  {
+    // Grow the buffer beforehand, to only measure serialization
+    if (RMW_RET_OK != rmw_serialize(ros_message, type_support, &serialized_message)) {
+      skip(st);
+      return;
+    }
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      if (RMW_RET_OK != rmw_serialize(ros_message, type_support, &serialized_message)) {
+        skip(st);
+        break;
+      }
+    }
+    st.SetBytesProcessed(
+      st.iterations() * static_cast<int64_t>(serialized_message.buffer_length));
+  }
+
+  void deserialize(
+    benchmark::State & st, void * ros_message,
+    const rosidl_message_type_support_t * type_support)
+  {
+    if (RMW_RET_OK != rmw_serialize(ros_message, type_support, &serialized_message)) {
+      skip(st);
+      return;
+    }
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      if (RMW_RET_OK != rmw_deserialize(&serialized_message, type_support, ros_message)) {
+        skip(st);
+        break;
+      }
+    }
+    st.SetBytesProcessed(
+      st.iterations() * static_cast<int64_t>(serialized_message.buffer_length));
+  }
+
+  template<size_t N, bool Plain>
+  void serialize_fixed_arrays(benchmark::State & st)
+  {
+    auto message = std::make_unique<FixedArrays<N>>();
+    serialize(st, message.get(), FixedArraysTypeSupport<N, Plain>::get());
+  }
+
+  template<size_t N, bool Plain>
+  void deserialize_fixed_arrays(benchmark::State & st)
+  {
+    auto message = std::make_unique<FixedArrays<N>>();
+    deserialize(st, message.get(), FixedArraysTypeSupport<N, Plain>::get());
+  }
+
+  void skip(benchmark::State & st)
+  {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+  }
+
+  rmw_serialized_message_t serialized_message;
+};
+
+BENCHMARK_F(SerializePlainPerformanceTest, serialize_basic_types)(benchmark::State & st)
+{
+  test_msgs__msg__BasicTypes message;
+  test_msgs__msg__BasicTypes__init(&message);
+  serialize(st, &message, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes));
+  test_msgs__msg__BasicTypes__fini(&message);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, deserialize_basic_types)(benchmark::State & st)
+{
+  test_msgs__msg__BasicTypes message;
+  test_msgs__msg__BasicTypes__init(&message);
+  deserialize(st, &message, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes));
+  test_msgs__msg__BasicTypes__fini(&message);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, serialize_small_arrays_bounded)(benchmark::State & st)
+{
+  serialize_fixed_arrays<16, false>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, serialize_small_arrays_plain)(benchmark::State & st)
+{
+  serialize_fixed_arrays<16, true>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, serialize_large_arrays_bounded)(benchmark::State & st)
+{
+  serialize_fixed_arrays<65536, false>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, serialize_large_arrays_plain)(benchmark::State & st)
+{
+  serialize_fixed_arrays<65536, true>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, deserialize_small_arrays_bounded)(benchmark::State & st)
+{
+  deserialize_fixed_arrays<16, false>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, deserialize_small_arrays_plain)(benchmark::State & st)
+{
+  deserialize_fixed_arrays<16, true>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, deserialize_large_arrays_bounded)(benchmark::State & st)
+{
+  deserialize_fixed_arrays<65536, false>(st);
+}
+
+BENCHMARK_F(SerializePlainPerformanceTest, deserialize_large_arrays_plain)(benchmark::State & st)
+{
+  deserialize_fixed_arrays<65536, true>(st);
+}
@@ -0,0 +1,700 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "fastdds/dds/subscriber/DataReader.hpp"
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/env.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+#include "rmw/subscription_content_filter_options.h"
+
+#include "rmw_fastrtps_cpp/get_subscriber.hpp"
+#include "rmw_fastrtps_cpp/loaned_serialized_message.hpp"
+
+#include "rosidl_runtime_c/string_functions.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/strings.h"
+
+// Subscriptions of a node of one context, with publishers both in that context (local) and in
+// another one (remote).
+class TestTake : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    init_context(&context);
+    node = rmw_create_node(&context, "my_node", "/my_ns");
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+    init_context(&remote_context);
+    remote_node = rmw_create_node(&remote_context, "my_remote_node", "/my_ns");
+    ASSERT_NE(nullptr, remote_node) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(remote_node)) << rmw_get_error_string().str;
+    fini_context(&remote_context);
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    fini_context(&context);
+  }
+
+  void init_context(rmw_context_t * ctx)
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    ret = rmw_init(&options, ctx);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  void fini_context(rmw_context_t * ctx)
+  {
+    rmw_ret_t ret = rmw_shutdown(ctx);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(ctx);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  // Wait until the subscription is matched with that many publishers.
+  void wait_for_publishers(const rmw_subscription_t * sub, size_t expected)
+  {
+    size_t count = 0u;
+    for (size_t i = 0; i < 500; ++i) {
+      ASSERT_EQ(RMW_RET_OK, rmw_subscription_count_matched_publishers(sub, &count));
+      if (count == expected) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    FAIL() << "subscription matched " << count << " publishers instead of " << expected;
+  }
+
+  // Wait until the reader of the subscription has at least that many unread samples.
+  void wait_for_samples(rmw_subscription_t * sub, uint64_t expected)
+  {
+    eprosima::fastdds::dds::DataReader * reader = rmw_fastrtps_cpp::get_datareader(sub);
+    ASSERT_NE(nullptr, reader);
+    for (size_t i = 0; i < 500; ++i) {
+      if (reader->get_unread_count() >= expected) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    FAIL() << "only " << reader->get_unread_count() << " samples received";
+  }
+
+  void publish(const rmw_publisher_t * pub, int32_t value)
+  {
+    test_msgs__msg__BasicTypes msg;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+    msg.int32_value = value;
+    EXPECT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rmw_get_error_string().str;
+    test_msgs__msg__BasicTypes__fini(&msg);
+  }
+
+  void publish(const rmw_publisher_t * pub, const char * value)
+  {
+    test_msgs__msg__Strings msg;
+    ASSERT_TRUE(test_msgs__msg__Strings__init(&msg));
+    ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg.string_value, value));
+    EXPECT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rmw_get_error_string().str;
+    test_msgs__msg__Strings__fini(&msg);
+  }
+
+  // Check that a message was published by that publisher.
+  void expect_published_by(const rmw_publisher_t * pub, const rmw_message_info_t & message_info)
+  {
+    rmw_gid_t gid;
+    ASSERT_EQ(RMW_RET_OK, rmw_get_gid_for_publisher(pub, &gid));
+    bool same = false;
+    ASSERT_EQ(RMW_RET_OK, rmw_compare_gids_equal(&gid, &message_info.publisher_gid, &same));
+    EXPECT_TRUE(same);
+  }
+
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_context_t remote_context{rmw_get_zero_initialized_context()};
+  rmw_node_t * remote_node{nullptr};
+};
+
+// Messages given to rmw_take_sequence, which must stay where the caller put them.
+class MessageSequence
+{
+public:
+  explicit MessageSequence(size_t size)
+  : messages_(size)
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    EXPECT_EQ(RMW_RET_OK, rmw_message_sequence_init(&sequence, size, &allocator));
+    EXPECT_EQ(RMW_RET_OK, rmw_message_info_sequence_init(&info_sequence, size, &allocator));
+    for (size_t i = 0; i < size; ++i) {
+      EXPECT_TRUE(test_msgs__msg__BasicTypes__init(&messages_[i]));
+      messages_[i].int32_value = -1;
+      sequence.data[i] = &messages_[i];
+    }
+  }
+
+  ~MessageSequence()
+  {
+    for (auto & message : messages_) {
+      test_msgs__msg__BasicTypes__fini(&message);
+    }
+    rmw_message_sequence_fini(&sequence);
+    rmw_message_info_sequence_fini(&info_sequence);
+  }
+
+  // Check that every message is still at its index, and that the taken ones are the expected
+  // values, in order.
+  void expect_taken(size_t taken, const std::vector<int32_t> & values) const
+  {
+    ASSERT_EQ(values.size(), taken);
+    EXPECT_EQ(taken, sequence.size);
+    EXPECT_EQ(taken, info_sequence.size);
+    for (size_t i = 0; i < messages_.size(); ++i) {
+      EXPECT_EQ(&messages_[i], sequence.data[i]) << "message " << i << " was moved";
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      EXPECT_EQ(values[i], messages_[i].int32_value) << "message " << i;
+    }
+  }
+
+  rmw_message_sequence_t sequence{rmw_get_zero_initialized_message_sequence()};
+  rmw_message_info_sequence_t info_sequence{rmw_get_zero_initialized_message_info_sequence()};
+
+private:
+  std::vector<test_msgs__msg__BasicTypes> messages_;
+};
+
+TEST_F(TestTake, take_sequence_drops_local_publications_in_the_middle) {
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  constexpr char topic_name[] = "/test_take_sequence_local";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  sub_options.ignore_local_publications = true;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * local_pub =
+    rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, local_pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, local_pub)) << rmw_get_error_string().str;
+  });
+  rmw_publisher_t * remote_pub =
+    rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, remote_pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, remote_pub)) <<
+      rmw_get_error_string().str;
+  });
+  wait_for_publishers(sub, 2u);
+
+  publish(remote_pub, 1);
+  publish(local_pub, 2);
+  publish(local_pub, 3);
+  publish(remote_pub, 4);
+  publish(local_pub, 5);
+  publish(remote_pub, 6);
+  wait_for_samples(sub, 6u);
+
+  MessageSequence messages(6u);
+  size_t taken = 0u;
+  rmw_ret_t ret = rmw_take_sequence(
+    sub, 6u, &messages.sequence, &messages.info_sequence, &taken, nullptr);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  messages.expect_taken(taken, {1, 4, 6});
+
+  for (size_t i = 0; i < taken; ++i) {
+    SCOPED_TRACE("message " + std::to_string(i));
+    expect_published_by(remote_pub, messages.info_sequence.data[i]);
+  }
+}
+
+TEST_F(TestTake, take_sequence_skips_samples_without_data_in_the_middle) {
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  constexpr char topic_name[] = "/test_take_sequence_invalid";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * first_pub =
+    rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, first_pub) << rmw_get_error_string().str;
+  wait_for_publishers(sub, 1u);
+  publish(first_pub, 1);
+  publish(first_pub, 2);
+  wait_for_samples(sub, 2u);
+
+  // Losing the only writer of the topic gives the reader a sample without data.
+  ASSERT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, first_pub)) <<
+    rmw_get_error_string().str;
+  wait_for_publishers(sub, 0u);
+
+  rmw_publisher_t * second_pub =
+    rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, second_pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, second_pub)) <<
+      rmw_get_error_string().str;
+  });
+  wait_for_publishers(sub, 1u);
+  publish(second_pub, 3);
+  publish(second_pub, 4);
+  wait_for_samples(sub, 4u);
+
+  MessageSequence messages(8u);
+  size_t taken = 0u;
+  rmw_ret_t ret = rmw_take_sequence(
+    sub, 8u, &messages.sequence, &messages.info_sequence, &taken, nullptr);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  messages.expect_taken(taken, {1, 2, 3, 4});
+}
+
+// Deserialize the string of a serialized test_msgs/Strings message.
+static std::string
+deserialize_string(const rmw_serialized_message_t * serialized_message)
+{
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  test_msgs__msg__Strings msg;
+  EXPECT_TRUE(test_msgs__msg__Strings__init(&msg));
+  std::string value;
+  rmw_ret_t ret = rmw_deserialize(serialized_message, ts, &msg);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  if (RMW_RET_OK == ret) {
+    value = msg.string_value.data;
+  }
+  test_msgs__msg__Strings__fini(&msg);
+  return value;
+}
+
+TEST_F(TestTake, take_and_return_serialized_loans_of_non_plain_type) {
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  constexpr char topic_name[] = "/test_take_serialized_loans";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub =
+    rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, pub)) << rmw_get_error_string().str;
+  });
+  wait_for_publishers(sub, 1u);
+
+  publish(pub, "one");
+  publish(pub, "two");
+  publish(pub, "three");
+  wait_for_samples(sub, 3u);
+
+  // Keep all of them loaned at once
+  std::vector<rmw_serialized_message_t *> loans;
+  bool taken = false;
+  for (size_t i = 0; i < 3u; ++i) {
+    rmw_serialized_message_t * loan = nullptr;
+    rmw_message_info_t message_info = rmw_get_zero_initialized_message_info();
+    rmw_ret_t ret =
+      rmw_fastrtps_cpp::take_loaned_serialized_message(sub, &loan, &taken, &message_info);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_TRUE(taken);
+    ASSERT_NE(nullptr, loan);
+    EXPECT_NE(0, message_info.source_timestamp);
+    loans.push_back(loan);
+  }
+  EXPECT_EQ(3u, std::set<rmw_serialized_message_t *>(loans.begin(), loans.end()).size());
+  EXPECT_EQ("one", deserialize_string(loans[0]));
+  EXPECT_EQ("two", deserialize_string(loans[1]));
+  EXPECT_EQ("three", deserialize_string(loans[2]));
+
+  rmw_serialized_message_t * loan = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_fastrtps_cpp::take_loaned_serialized_message(sub, &loan, &taken, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_FALSE(taken);
+
+  // Return them out of order, each one only once
+  EXPECT_EQ(RMW_RET_OK, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, loans[1])) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, loans[0])) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_ERROR, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, loans[1]));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_OK, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, loans[2])) <<
+    rmw_get_error_string().str;
+
+  rmw_serialized_message_t not_loaned = rmw_get_zero_initialized_serialized_message();
+  EXPECT_EQ(RMW_RET_ERROR, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, &not_loaned));
+  rmw_reset_error();
+
+  // The returned loans can be taken again
+  publish(pub, "four");
+  wait_for_samples(sub, 1u);
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_fastrtps_cpp::take_loaned_serialized_message(sub, &loan, &taken, nullptr)) <<
+    rmw_get_error_string().str;
+  ASSERT_TRUE(taken);
+  EXPECT_EQ("four", deserialize_string(loan));
+  EXPECT_EQ(RMW_RET_OK, rmw_fastrtps_cpp::return_loaned_serialized_message(sub, loan)) <<
+    rmw_get_error_string().str;
+}
+
+TEST_F(TestTake, serialized_loans_of_plain_type_are_unsupported) {
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  constexpr char topic_name[] = "/test_take_serialized_loans_plain";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub =
+    rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, pub)) << rmw_get_error_string().str;
+  });
+  wait_for_publishers(sub, 1u);
+  publish(pub, 1);
+  wait_for_samples(sub, 1u);
+
+  rmw_serialized_message_t * loan = nullptr;
+  bool taken = false;
+  EXPECT_EQ(
+    RMW_RET_UNSUPPORTED,
+    rmw_fastrtps_cpp::take_loaned_serialized_message(sub, &loan, &taken, nullptr));
+  rmw_reset_error();
+  EXPECT_FALSE(taken);
+  rmw_serialized_message_t not_loaned = rmw_get_zero_initialized_serialized_message();
+  EXPECT_EQ(
+    RMW_RET_UNSUPPORTED,
+    rmw_fastrtps_cpp::return_loaned_serialized_message(sub, &not_loaned));
+  rmw_reset_error();
+
+  // The sample is still there, loaned as a message when data-sharing allows it
+  if (sub->can_loan_messages) {
+    void * loaned_message = nullptr;
+    ASSERT_EQ(RMW_RET_OK, rmw_take_loaned_message(sub, &loaned_message, &taken, nullptr)) <<
+      rmw_get_error_string().str;
+    ASSERT_TRUE(taken);
+    EXPECT_EQ(1, static_cast<test_msgs__msg__BasicTypes *>(loaned_message)->int32_value);
+    EXPECT_EQ(
+      RMW_RET_OK, rmw_return_loaned_message_from_subscription(sub, loaned_message)) <<
+      rmw_get_error_string().str;
+  } else {
+    test_msgs__msg__BasicTypes msg;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+    EXPECT_EQ(RMW_RET_OK, rmw_take(sub, &msg, &taken, nullptr)) << rmw_get_error_string().str;
+    EXPECT_TRUE(taken);
+    EXPECT_EQ(1, msg.int32_value);
+    test_msgs__msg__BasicTypes__fini(&msg);
+  }
+}
+
+// Publishers of a topic in the node of the subscription (local) and in the other one (remote),
+// and a subscription ignoring the local ones.
+class TestTakeIgnoringLocalPublications : public TestTake
+{
+protected:
+  void create_entities(const rosidl_message_type_support_t * ts, const char * topic_name)
+  {
+    rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+    qos_profile.depth = 10;
+    rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+    sub_options.ignore_local_publications = true;
+    sub = rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+    ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    local_pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+    ASSERT_NE(nullptr, local_pub) << rmw_get_error_string().str;
+    remote_pub = rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+    ASSERT_NE(nullptr, remote_pub) << rmw_get_error_string().str;
+    wait_for_publishers(sub, 2u);
+  }
+
+  void TearDown() override
+  {
+    if (nullptr != remote_pub) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, remote_pub)) <<
+        rmw_get_error_string().str;
+    }
+    if (nullptr != local_pub) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, local_pub)) <<
+        rmw_get_error_string().str;
+    }
+    if (nullptr != sub) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+    }
+    TestTake::TearDown();
+  }
+
+  rmw_subscription_t * sub{nullptr};
+  rmw_publisher_t * local_pub{nullptr};
+  rmw_publisher_t * remote_pub{nullptr};
+};
+
+TEST_F(TestTakeIgnoringLocalPublications, take_drops_local_publications_of_plain_type) {
+  create_entities(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), "/test_take_local");
+  ASSERT_FALSE(HasFatalFailure());
+
+  publish(local_pub, 1);
+  publish(remote_pub, 2);
+  publish(local_pub, 3);
+  publish(local_pub, 4);
+  publish(remote_pub, 5);
+  publish(local_pub, 6);
+  wait_for_samples(sub, 6u);
+
+  std::vector<int32_t> values;
+  while (true) {
+    test_msgs__msg__BasicTypes msg;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+    bool taken = false;
+    rmw_message_info_t message_info = rmw_get_zero_initialized_message_info();
+    rmw_ret_t ret = rmw_take_with_info(sub, &msg, &taken, &message_info, nullptr);
+    int32_t value = msg.int32_value;
+    test_msgs__msg__BasicTypes__fini(&msg);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    if (!taken) {
+      break;
+    }
+    values.push_back(value);
+    expect_published_by(remote_pub, message_info);
+  }
+  EXPECT_EQ((std::vector<int32_t>{2, 5}), values);
+}
+
+TEST_F(TestTakeIgnoringLocalPublications, take_drops_local_publications_of_non_plain_type) {
+  // Samples of non-plain types are dropped without deserializing them
+  create_entities(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings), "/test_take_local_strings");
+  ASSERT_FALSE(HasFatalFailure());
+
+  publish(local_pub, "one");
+  publish(remote_pub, "two");
+  publish(local_pub, "three");
+  publish(local_pub, "four");
+  publish(remote_pub, "five");
+  publish(local_pub, "six");
+  wait_for_samples(sub, 6u);
+
+  std::vector<std::string> values;
+  while (true) {
+    test_msgs__msg__Strings msg;
+    ASSERT_TRUE(test_msgs__msg__Strings__init(&msg));
+    bool taken = false;
+    rmw_message_info_t message_info = rmw_get_zero_initialized_message_info();
+    rmw_ret_t ret = rmw_take_with_info(sub, &msg, &taken, &message_info, nullptr);
+    std::string value = msg.string_value.data;
+    test_msgs__msg__Strings__fini(&msg);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    if (!taken) {
+      break;
+    }
+    values.push_back(value);
+    expect_published_by(remote_pub, message_info);
+  }
+  EXPECT_EQ((std::vector<std::string>{"two", "five"}), values);
+}
+
+// Publishers compressing the payloads they can, as enabled by RMW_FASTRTPS_COMPRESSION_THRESHOLD.
+class TestTakeCompressed : public TestTake
+{
+protected:
+  void SetUp() override
+  {
+    ASSERT_TRUE(rcutils_set_env("RMW_FASTRTPS_COMPRESSION_THRESHOLD", "1"));
+    TestTake::SetUp();
+  }
+
+  void TearDown() override
+  {
+    TestTake::TearDown();
+    EXPECT_TRUE(rcutils_set_env("RMW_FASTRTPS_COMPRESSION_THRESHOLD", nullptr));
+  }
+
+  // Publish messages which compress well, prefixed by the given string.
+  void publish_compressible(const rmw_publisher_t * pub, const std::string & prefix)
+  {
+    publish(pub, (prefix + std::string(1000u, 'x')).c_str());
+  }
+
+  // Take the prefixes of the messages published by publish_compressible().
+  std::vector<std::string> take_prefixes(rmw_subscription_t * sub)
+  {
+    std::vector<std::string> prefixes;
+    while (true) {
+      test_msgs__msg__Strings msg;
+      EXPECT_TRUE(test_msgs__msg__Strings__init(&msg));
+      bool taken = false;
+      rmw_ret_t ret = rmw_take(sub, &msg, &taken, nullptr);
+      std::string value = msg.string_value.data;
+      test_msgs__msg__Strings__fini(&msg);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+      if (RMW_RET_OK != ret || !taken) {
+        break;
+      }
+      prefixes.push_back(value.substr(0u, 4u));
+    }
+    return prefixes;
+  }
+
+  void publish_and_take_filtered(rmw_subscription_t * sub, const char * topic_name)
+  {
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+    rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+    qos_profile.depth = 10;
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    rmw_publisher_t * pub =
+      rmw_create_publisher(remote_node, ts, topic_name, &qos_profile, &pub_options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(remote_node, pub)) <<
+        rmw_get_error_string().str;
+    });
+    wait_for_publishers(sub, 1u);
+
+    publish_compressible(pub, "keep");
+    publish_compressible(pub, "drop");
+    publish_compressible(pub, "keep");
+    wait_for_samples(sub, 2u);
+    EXPECT_EQ((std::vector<std::string>{"keep", "keep"}), take_prefixes(sub));
+  }
+
+  static constexpr char filter_expression[] = "string_value LIKE 'keep%'";
+};
+
+constexpr char TestTakeCompressed::filter_expression[];
+
+TEST_F(TestTakeCompressed, content_filter_set_on_creation) {
+  // The filter is evaluated on uncompressed payloads
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  constexpr char topic_name[] = "/test_take_compressed_filtered";
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_subscription_content_filter_options_t filter_options =
+    rmw_get_zero_initialized_content_filter_options();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_subscription_content_filter_options_init(
+      filter_expression, 0u, nullptr, &allocator, &filter_options)) <<
+    rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(
+      RMW_RET_OK, rmw_subscription_content_filter_options_fini(&filter_options, &allocator));
+  });
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  sub_options.content_filter_options = &filter_options;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+  EXPECT_TRUE(sub->is_cft_enabled);
+
+  publish_and_take_filtered(sub, topic_name);
+}
+
+TEST_F(TestTakeCompressed, content_filter_set_after_creation) {
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  constexpr char topic_name[] = "/test_take_compressed_filtered_later";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_subscription_content_filter_options_t filter_options =
+    rmw_get_zero_initialized_content_filter_options();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_subscription_content_filter_options_init(
+      filter_expression, 0u, nullptr, &allocator, &filter_options)) <<
+    rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(
+      RMW_RET_OK, rmw_subscription_content_filter_options_fini(&filter_options, &allocator));
+  });
+  ASSERT_EQ(RMW_RET_OK, rmw_subscription_set_content_filter(sub, &filter_options)) <<
+    rmw_get_error_string().str;
+
+  publish_and_take_filtered(sub, topic_name);
+}
@@ -50,6 +50,10 @@ MessageTypeSupport<MembersType>::MessageTypeSupport(
   ss << "dds_::" << message_name << "_";
   this->setName(ss.str().c_str());
 
+  // Walk the members once, rather than for each message
+  this->compilePlan(this->members_, 0);
+  this->coalescePlan();
+
   // Fully bound and plain by default
   this->max_size_bound_ = true;
   this->is_plain_ = true;
@@ -62,6 +66,10 @@ MessageTypeSupport<MembersType>::MessageTypeSupport(
   }
   // Account for RTPS submessage alignment
   this->m_typeSize = (this->m_typeSize + 3) & ~3;
+
+  // Only strings and sequences were checked above: messages are only loaned as they are, e.g.
+  // with data-sharing, when they also have their CDR layout in memory.
+  this->is_plain_ = this->is_plain_ && this->planCopiesWholeMessage();
 }
 
 }  // namespace rmw_fastrtps_dynamic_cpp
@@ -49,6 +49,10 @@ RequestTypeSupport<ServiceMembersType, MessageMembersType>::RequestTypeSupport(
   ss << "dds_::" << service_name << "_Request_";
   this->setName(ss.str().c_str());
 
+  // Walk the members once, rather than for each message
+  this->compilePlan(this->members_, 0);
+  this->coalescePlan();
+
   // Fully bound and plain by default
   this->max_size_bound_ = true;
   this->is_plain_ = true;
@@ -82,6 +86,10 @@ ResponseTypeSupport<ServiceMembersType, MessageMembersType>::ResponseTypeSupport
   ss << "dds_::" << service_name << "_Response_";
   this->setName(ss.str().c_str());
 
+  // Walk the members once, rather than for each message
+  this->compilePlan(this->members_, 0);
+  this->coalescePlan();
+
   // Fully bound and plain by default
   this->max_size_bound_ = true;
   this->is_plain_ = true;
@@ -16,13 +16,18 @@
 #define RMW_FASTRTPS_DYNAMIC_CPP__TYPESUPPORT_HPP_
 
 #include <cassert>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "rosidl_runtime_c/string.h"
 #include "rosidl_runtime_c/string_functions.h"
 
 #include "fastcdr/FastBuffer.h"
 #include "fastcdr/Cdr.h"
+#include "fastcdr/exceptions/NotEnoughMemoryException.h"
 
 #include "rcutils/logging_macros.h"
 
@@ -40,6 +45,8 @@
 
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
 
+#include "rmw_fastrtps_dynamic_cpp/serialization_plan.hpp"
+
 namespace rmw_fastrtps_dynamic_cpp
 {
 
@@ -48,6 +55,33 @@ namespace rmw_fastrtps_dynamic_cpp
 template<typename MembersType>
 struct StringHelper;
 
+// Read the length of a serialized sequence, and check that that many elements, which are
+// serialized with at least `min_element_size` bytes each, fit in what is left of the buffer before
+// any room is made for them, so that a malformed length cannot cause a huge allocation.
+inline uint32_t
+deserialize_sequence_length(eprosima::fastcdr::Cdr & deser, size_t min_element_size)
+{
+  uint32_t length = 0;
+  deser >> length;
+  eprosima::fastcdr::Cdr::state state = deser.getState();
+  if (length > (std::numeric_limits<size_t>::max)() / min_element_size ||
+    !deser.jump(length * min_element_size))
+  {
+    throw eprosima::fastcdr::exception::NotEnoughMemoryException(
+      eprosima::fastcdr::exception::NotEnoughMemoryException::NOT_ENOUGH_MEMORY_MESSAGE_DEFAULT);
+  }
+  deser.setState(state);
+  return length;
+}
+
+// Read the length of a serialized string, including its terminating null character, and check
+// that the string fits in what is left of the buffer before any room is made for it.
+inline uint32_t
+deserialize_string_length(eprosima::fastcdr::Cdr & deser)
+{
+  return deserialize_sequence_length(deser, 1u);
+}
+
 // For C introspection typesupport we create intermediate instances of std::string so that
 // eprosima::fastcdr::Cdr can handle the string properly.
 template<>
@@ -99,12 +133,29 @@ struct StringHelper<rosidl_typesupport_introspection_c__MessageMembers>
     return std::string(data.data);
   }
 
+  // The string is serialized straight from its characters, without copying them.
+  static void serialize(eprosima::fastcdr::Cdr & ser, const rosidl_runtime_c__String & str)
+  {
+    ser.serialize(str.data ? str.data : "");
+  }
+
+  // The string is deserialized in place, it is only reallocated when it is too small.
   static void assign(eprosima::fastcdr::Cdr & deser, void * field)
   {
-    std::string str;
-    deser >> str;
     rosidl_runtime_c__String * c_str = static_cast<rosidl_runtime_c__String *>(field);
-    rosidl_runtime_c__String__assign(c_str, str.c_str());
+    uint32_t length = deserialize_string_length(deser);
+    if (c_str->capacity <= length) {
+      if (!rosidl_runtime_c__String__assignn(c_str, deser.getCurrentPosition(), length)) {
+        throw std::runtime_error("unable to assign rosidl_runtime_c__String");
+      }
+    }
+    deser.deserializeArray(c_str->data, length);
+    size_t size = length;
+    if (size > 0 && c_str->data[size - 1] == '\0') {
+      --size;
+    }
+    c_str->data[size] = '\0';
+    c_str->size = size;
   }
 };
 
@@ -119,10 +170,16 @@ struct StringHelper<rosidl_typesupport_introspection_cpp::MessageMembers>
     return *(static_cast<std::string *>(data));
   }
 
+  // The string is deserialized in place, resizing it keeps its storage when it is large enough.
   static void assign(eprosima::fastcdr::Cdr & deser, void * field)
   {
     std::string & str = *(std::string *)field;
-    deser >> str;
+    uint32_t length = deserialize_string_length(deser);
+    str.resize(length);
+    deser.deserializeArray(&str[0], length);
+    if (length > 0 && str[length - 1] == '\0') {
+      str.resize(length - 1);
+    }
   }
 };
 
@@ -171,27 +228,45 @@ public:
     eprosima::fastcdr::Cdr & deser, void * ros_message, const void * impl) const override;
 
 protected:
+  using MemberType = typename std::remove_const<
+    typename std::remove_pointer<decltype(MembersType::members_)>::type>::type;
+  using Instruction = PlanInstruction<MemberType>;
+
   explicit TypeSupport(const void * ros_type_support);
 
   size_t calculateMaxSerializedSize(const MembersType * members, size_t current_alignment);
 
+  // Append the instructions of the members to the plan, at an offset from the message being run.
+  void compilePlan(const MembersType * members, size_t offset);
+
+  // Precede the runs of primitives which can be copied at once with a block instruction.
+  void coalescePlan();
+
+  // Whether the plan copies the whole message at once, i.e. it has the layout it has in CDR,
+  // without any padding CDR does not have, even at its end.
+  bool planCopiesWholeMessage() const;
+
   const MembersType * members_;
 
+  std::vector<Instruction> plan_;
+
 private:
-  size_t getEstimatedSerializedSize(
-    const MembersType * members,
-    const void * ros_message,
-    size_t current_alignment) const;
+  template<typename T>
+  void appendPrimitive(const MemberType * member, size_t offset);
 
-  bool serializeROSmessage(
-    eprosima::fastcdr::Cdr & ser,
-    const MembersType * members,
-    const void * ros_message) const;
+  template<typename T>
+  void appendString(const MemberType * member, size_t offset);
 
-  bool deserializeROSmessage(
-    eprosima::fastcdr::Cdr & deser,
-    const MembersType * members,
-    void * ros_message) const;
+  size_t estimatePlan(
+    size_t begin, size_t end, const void * ros_message, size_t current_alignment) const;
+
+  bool serializePlan(
+    eprosima::fastcdr::Cdr & ser, size_t begin, size_t end, const void * ros_message,
+    size_t origin) const;
+
+  bool deserializePlan(
+    eprosima::fastcdr::Cdr & deser, size_t begin, size_t end, void * ros_message,
+    size_t origin) const;
 };
 
 }  // namespace rmw_fastrtps_dynamic_cpp
@@ -15,15 +15,20 @@
 #ifndef RMW_FASTRTPS_DYNAMIC_CPP__TYPESUPPORT_IMPL_HPP_
 #define RMW_FASTRTPS_DYNAMIC_CPP__TYPESUPPORT_IMPL_HPP_
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "fastcdr/Cdr.h"
 #include "fastcdr/FastBuffer.h"
 #include "fastcdr/exceptions/Exception.h"
+#include "fastcdr/exceptions/NotEnoughMemoryException.h"
 
 #include "rmw_fastrtps_dynamic_cpp/TypeSupport.hpp"
+#include "rmw_fastrtps_dynamic_cpp/byte_swap.hpp"
 #include "rmw_fastrtps_dynamic_cpp/macros.hpp"
 
 #include "rmw/error_handling.h"
@@ -141,33 +146,28 @@ void serialize_field<std::string>(
 {
   using CStringHelper = StringHelper<rosidl_typesupport_introspection_c__MessageMembers>;
   if (!member->is_array_) {
-    auto && str = CStringHelper::convert_to_std_string(field);
+    auto c_string = static_cast<rosidl_runtime_c__String *>(field);
     // Control maximum length.
-    if (member->string_upper_bound_ && str.length() > member->string_upper_bound_ + 1) {
+    if (member->string_upper_bound_ && c_string->data &&
+      strlen(c_string->data) > member->string_upper_bound_ + 1)
+    {
       throw std::runtime_error("string overcomes the maximum length");
     }
-    ser << str;
+    CStringHelper::serialize(ser, *c_string);
   } else {
-    // First, cast field to rosidl_generator_c
-    // Then convert to a std::string using StringHelper and serialize the std::string
+    // The strings are serialized from the rosidl_runtime_c__String, without intermediate copies
     if (member->array_size_ && !member->is_upper_bound_) {
-      // tmpstring is defined here and not below to avoid
-      // memory allocation in every iteration of the for loop
-      std::string tmpstring;
       auto string_field = static_cast<rosidl_runtime_c__String *>(field);
       for (size_t i = 0; i < member->array_size_; ++i) {
-        tmpstring = string_field[i].data;
-        ser.serialize(tmpstring);
+        CStringHelper::serialize(ser, string_field[i]);
       }
     } else {
       auto & string_sequence_field =
         *reinterpret_cast<rosidl_runtime_c__String__Sequence *>(field);
-      std::vector<std::string> cpp_string_vector;
+      ser << static_cast<uint32_t>(string_sequence_field.size);
       for (size_t i = 0; i < string_sequence_field.size; ++i) {
-        cpp_string_vector.push_back(
-          CStringHelper::convert_to_std_string(string_sequence_field.data[i]));
+        CStringHelper::serialize(ser, string_sequence_field.data[i]);
       }
-      ser << cpp_string_vector;
     }
   }
 }
@@ -200,105 +200,6 @@ void serialize_field<std::wstring>(
   }
 }
 
-template<typename MembersType>
-bool TypeSupport<MembersType>::serializeROSmessage(
-  eprosima::fastcdr::Cdr & ser,
-  const MembersType * members,
-  const void * ros_message) const
-{
-  assert(members);
-  assert(ros_message);
-
-  for (uint32_t i = 0; i < members->member_count_; ++i) {
-    const auto member = members->members_ + i;
-    void * field = const_cast<char *>(static_cast<const char *>(ros_message)) + member->offset_;
-    switch (member->type_id_) {
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOL:
-        if (!member->is_array_) {
-          // don't cast to bool here because if the bool is
-          // uninitialized the random value can't be deserialized
-          ser << (*static_cast<uint8_t *>(field) ? true : false);
-        } else {
-          serialize_field<bool>(member, field, ser);
-        }
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BYTE:
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
-        serialize_field<uint8_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
-        serialize_field<char>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT32:
-        serialize_field<float>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT64:
-        serialize_field<double>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
-        serialize_field<int16_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
-        serialize_field<uint16_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
-        serialize_field<int32_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
-        serialize_field<uint32_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
-        serialize_field<int64_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
-        serialize_field<uint64_t>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
-        serialize_field<std::string>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
-        serialize_field<std::wstring>(member, field, ser);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
-        {
-          auto sub_members = static_cast<const MembersType *>(member->members_->data);
-          if (!member->is_array_) {
-            serializeROSmessage(ser, sub_members, field);
-          } else {
-            size_t array_size = 0;
-
-            if (member->array_size_ && !member->is_upper_bound_) {
-              array_size = member->array_size_;
-            } else {
-              if (!member->size_function) {
-                RMW_SET_ERROR_MSG("unexpected error: size function is null");
-                return false;
-              }
-              array_size = member->size_function(field);
-
-              // Serialize length
-              ser << (uint32_t)array_size;
-            }
-
-            if (array_size != 0 && !member->get_function) {
-              RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
-              return false;
-            }
-            for (size_t index = 0; index < array_size; ++index) {
-              serializeROSmessage(ser, sub_members, member->get_function(field, index));
-            }
-          }
-        }
-        break;
-      default:
-        throw std::runtime_error("unknown type");
-    }
-  }
-
-  return true;
-}
-
 // C++ specialization
 template<typename T>
 size_t next_field_align(
@@ -461,102 +362,43 @@ size_t next_field_align_string<std::wstring>(
   return current_alignment;
 }
 
-template<typename MembersType>
-size_t TypeSupport<MembersType>::getEstimatedSerializedSize(
-  const MembersType * members,
-  const void * ros_message,
-  size_t current_alignment) const
+// Deserialize an array of primitives.
+// Fast CDR swaps the bytes of the elements of a payload of the other endianness one at a time,
+// so they are rather copied as they are, and then swapped all at once.
+template<typename T>
+inline void deserialize_array(eprosima::fastcdr::Cdr & deser, T * data, size_t count)
 {
-  assert(members);
-  assert(ros_message);
+  const auto endianness = deser.endianness();
+  if (sizeof(T) == 1 || eprosima::fastcdr::Cdr::DEFAULT_ENDIAN == endianness) {
+    deser.deserializeArray(data, count);
+    return;
+  }
+  deser.changeEndianness(eprosima::fastcdr::Cdr::DEFAULT_ENDIAN);
+  try {
+    deser.deserializeArray(data, count);
+  } catch (...) {
+    deser.changeEndianness(endianness);
+    throw;
+  }
+  deser.changeEndianness(endianness);
+  byte_swap_array(data, count);
+}
 
-  size_t initial_alignment = current_alignment;
+// Serialized strings take at least their length.
+constexpr size_t min_serialized_string_size = 4u;
 
-  for (uint32_t i = 0; i < members->member_count_; ++i) {
-    const auto member = members->members_ + i;
-    void * field = const_cast<char *>(static_cast<const char *>(ros_message)) + member->offset_;
-    switch (member->type_id_) {
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOL:
-        current_alignment = next_field_align<bool>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BYTE:
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
-        current_alignment = next_field_align<uint8_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
-        current_alignment = next_field_align<char>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT32:
-        current_alignment = next_field_align<float>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT64:
-        current_alignment = next_field_align<double>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
-        current_alignment = next_field_align<int16_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
-        current_alignment = next_field_align<uint16_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
-        current_alignment = next_field_align<int32_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
-        current_alignment = next_field_align<uint32_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
-        current_alignment = next_field_align<int64_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
-        current_alignment = next_field_align<uint64_t>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
-        current_alignment = next_field_align_string<std::string>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
-        current_alignment = next_field_align_string<std::wstring>(member, field, current_alignment);
-        break;
-      case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
-        {
-          auto sub_members = static_cast<const MembersType *>(member->members_->data);
-          if (!member->is_array_) {
-            current_alignment += getEstimatedSerializedSize(sub_members, field, current_alignment);
-          } else {
-            size_t array_size = 0;
-
-            if (member->array_size_ && !member->is_upper_bound_) {
-              array_size = member->array_size_;
-            } else {
-              if (!member->size_function) {
-                RMW_SET_ERROR_MSG("unexpected error: size function is null");
-                return false;
-              }
-              array_size = member->size_function(field);
-
-              // Length serialization
-              current_alignment += 4 + eprosima::fastcdr::Cdr::alignment(current_alignment, 4);
-            }
-
-            if (array_size != 0 && !member->get_function) {
-              RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
-              return false;
-            }
-            for (size_t index = 0; index < array_size; ++index) {
-              current_alignment += getEstimatedSerializedSize(
-                sub_members,
-                member->get_function(field, index),
-                current_alignment);
-            }
-          }
-        }
-        break;
-      default:
-        throw std::runtime_error("unknown type");
-    }
-  }
+template<typename T>
+inline void deserialize_sequence(eprosima::fastcdr::Cdr & deser, std::vector<T> & vector)
+{
+  uint32_t size = deserialize_sequence_length(deser, sizeof(T));
+  vector.resize(size);
+  deserialize_array(deser, vector.data(), size);
+}
 
-  return current_alignment - initial_alignment;
+// std::vector<bool> does not store its elements in an array.
+inline void deserialize_sequence(eprosima::fastcdr::Cdr & deser, std::vector<bool> & vector)
+{
+  deser >> vector;
 }
 
 template<typename T>
@@ -568,10 +410,10 @@ void deserialize_field(
   if (!member->is_array_) {
     deser >> *static_cast<T *>(field);
   } else if (member->array_size_ && !member->is_upper_bound_) {
-    deser.deserializeArray(static_cast<T *>(field), member->array_size_);
+    deserialize_array(deser, static_cast<T *>(field), member->array_size_);
   } else {
     auto & vector = *reinterpret_cast<std::vector<T> *>(field);
-    deser >> vector;
+    deserialize_sequence(deser, vector);
   }
 }
 
@@ -581,14 +423,21 @@ inline void deserialize_field<std::string>(
   void * field,
   eprosima::fastcdr::Cdr & deser)
 {
+  using CppStringHelper = StringHelper<rosidl_typesupport_introspection_cpp::MessageMembers>;
   if (!member->is_array_) {
-    deser >> *static_cast<std::string *>(field);
+    CppStringHelper::assign(deser, field);
   } else if (member->array_size_ && !member->is_upper_bound_) {
     std::string * array = static_cast<std::string *>(field);
-    deser.deserializeArray(array, member->array_size_);
+    for (size_t i = 0; i < member->array_size_; ++i) {
+      CppStringHelper::assign(deser, &array[i]);
+    }
   } else {
     auto & vector = *reinterpret_cast<std::vector<std::string> *>(field);
-    deser >> vector;
+    uint32_t size = deserialize_sequence_length(deser, min_serialized_string_size);
+    vector.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      CppStringHelper::assign(deser, &vector[i]);
+    }
   }
 }
 
@@ -608,7 +457,7 @@ inline void deserialize_field<std::wstring>(
     if (member->array_size_ && !member->is_upper_bound_) {
       size = static_cast<uint32_t>(member->array_size_);
     } else {
-      deser >> size;
+      size = deserialize_sequence_length(deser, min_serialized_string_size);
       member->resize_function(field, size);
     }
     for (size_t i = 0; i < size; ++i) {
@@ -629,13 +478,19 @@ void deserialize_field(
   if (!member->is_array_) {
     deser >> *static_cast<T *>(field);
   } else if (member->array_size_ && !member->is_upper_bound_) {
-    deser.deserializeArray(static_cast<T *>(field), member->array_size_);
+    deserialize_array(deser, static_cast<T *>(field), member->array_size_);
   } else {
     auto & data = *reinterpret_cast<typename GenericCSequence<T>::type *>(field);
-    int32_t dsize = 0;
-    deser >> dsize;
-    GenericCSequence<T>::init(&data, dsize);
-    deser.deserializeArray(reinterpret_cast<T *>(data.data), dsize);
+    uint32_t dsize = deserialize_sequence_length(deser, sizeof(T));
+    // The storage of the sequence is reused when it is large enough
+    if (data.capacity < dsize) {
+      GenericCSequence<T>::fini(&data);
+      if (!GenericCSequence<T>::init(&data, dsize)) {
+        throw std::runtime_error("unable to initialize sequence");
+      }
+    }
+    data.size = dsize;
+    deserialize_array(deser, reinterpret_cast<T *>(data.data), dsize);
   }
 }
 
@@ -649,37 +504,28 @@ inline void deserialize_field<std::string>(
     using CStringHelper = StringHelper<rosidl_typesupport_introspection_c__MessageMembers>;
     CStringHelper::assign(deser, field);
   } else {
+    using CStringHelper = StringHelper<rosidl_typesupport_introspection_c__MessageMembers>;
     if (member->array_size_ && !member->is_upper_bound_) {
       auto deser_field = static_cast<rosidl_runtime_c__String *>(field);
-      // tmpstring is defined here and not below to avoid
-      // memory allocation in every iteration of the for loop
-      std::string tmpstring;
       for (size_t i = 0; i < member->array_size_; ++i) {
-        deser.deserialize(tmpstring);
-        if (!rosidl_runtime_c__String__assign(&deser_field[i], tmpstring.c_str())) {
-          throw std::runtime_error("unable to assign rosidl_runtime_c__String");
-        }
+        CStringHelper::assign(deser, &deser_field[i]);
       }
     } else {
-      std::vector<std::string> cpp_string_vector;
-      deser >> cpp_string_vector;
+      uint32_t size = deserialize_sequence_length(deser, min_serialized_string_size);
 
+      // The strings of the sequence are reused when there are enough of them
       auto & string_sequence_field =
         *reinterpret_cast<rosidl_runtime_c__String__Sequence *>(field);
-      if (
-        !rosidl_runtime_c__String__Sequence__init(
-          &string_sequence_field, cpp_string_vector.size()))
-      {
-        throw std::runtime_error("unable to initialize rosidl_runtime_c__String array");
+      if (string_sequence_field.capacity < size) {
+        rosidl_runtime_c__String__Sequence__fini(&string_sequence_field);
+        if (!rosidl_runtime_c__String__Sequence__init(&string_sequence_field, size)) {
+          throw std::runtime_error("unable to initialize rosidl_runtime_c__String array");
+        }
       }
+      string_sequence_field.size = size;
 
-      for (size_t i = 0; i < cpp_string_vector.size(); ++i) {
-        if (
-          !rosidl_runtime_c__String__assign(
-            &string_sequence_field.data[i], cpp_string_vector[i].c_str()))
-        {
-          throw std::runtime_error("unable to assign rosidl_runtime_c__String");
-        }
+      for (size_t i = 0; i < size; ++i) {
+        CStringHelper::assign(deser, &string_sequence_field.data[i]);
       }
     }
   }
@@ -703,111 +549,562 @@ inline void deserialize_field<std::wstring>(
       rosidl_typesupport_fastrtps_c::wstring_to_u16string(wstr, array[i]);
     }
   } else {
-    uint32_t size;
-    deser >> size;
+    uint32_t size = deserialize_sequence_length(deser, min_serialized_string_size);
+    // The strings of the sequence are reused when there are enough of them
     auto sequence = static_cast<rosidl_runtime_c__U16String__Sequence *>(field);
-    if (!rosidl_runtime_c__U16String__Sequence__init(sequence, size)) {
-      throw std::runtime_error("unable to initialize rosidl_runtime_c__U16String sequence");
+    if (sequence->capacity < size) {
+      rosidl_runtime_c__U16String__Sequence__fini(sequence);
+      if (!rosidl_runtime_c__U16String__Sequence__init(sequence, size)) {
+        throw std::runtime_error("unable to initialize rosidl_runtime_c__U16String sequence");
+      }
     }
-    for (size_t i = 0; i < sequence->size; ++i) {
+    sequence->size = size;
+    for (size_t i = 0; i < size; ++i) {
       deser >> wstr;
       rosidl_typesupport_fastrtps_c::wstring_to_u16string(wstr, sequence->data[i]);
     }
   }
 }
 
+// Primitives are (de)serialized as unsigned integers of the same size, which are encoded the same
+// way, so that instructions only need the size of their elements.
+template<typename T>
+inline void serialize_primitives(eprosima::fastcdr::Cdr & ser, const void * data, size_t count)
+{
+  if (1u == count) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    ser << value;
+  } else {
+    ser.serializeArray(static_cast<const T *>(data), count);
+  }
+}
+
+inline void serialize_primitives(
+  eprosima::fastcdr::Cdr & ser, const void * data, size_t size, size_t count)
+{
+  switch (size) {
+    case 1:
+      serialize_primitives<uint8_t>(ser, data, count);
+      break;
+    case 2:
+      serialize_primitives<uint16_t>(ser, data, count);
+      break;
+    case 4:
+      serialize_primitives<uint32_t>(ser, data, count);
+      break;
+    default:
+      serialize_primitives<uint64_t>(ser, data, count);
+      break;
+  }
+}
+
+template<typename T>
+inline void deserialize_primitives(eprosima::fastcdr::Cdr & deser, void * data, size_t count)
+{
+  if (1u == count) {
+    T value;
+    deser >> value;
+    memcpy(data, &value, sizeof(T));
+  } else {
+    deserialize_array(deser, static_cast<T *>(data), count);
+  }
+}
+
+inline void deserialize_primitives(
+  eprosima::fastcdr::Cdr & deser, void * data, size_t size, size_t count)
+{
+  switch (size) {
+    case 1:
+      deserialize_primitives<uint8_t>(deser, data, count);
+      break;
+    case 2:
+      deserialize_primitives<uint16_t>(deser, data, count);
+      break;
+    case 4:
+      deserialize_primitives<uint32_t>(deser, data, count);
+      break;
+    default:
+      deserialize_primitives<uint64_t>(deser, data, count);
+      break;
+  }
+}
+
+// Same as eprosima::fastcdr::Cdr::alignment, without a division, for the sizes only known at run
+// time of the instructions, which are powers of two.
+inline size_t plan_alignment(size_t current_alignment, size_t data_size)
+{
+  return (0u - current_alignment) & (data_size - 1u);
+}
+
+// Functions run by the FIELD instructions of a plan, for strings and sequences.
+template<typename T, typename MemberType>
+void plan_serialize_member(
+  eprosima::fastcdr::Cdr & ser, const PlanInstruction<MemberType> & instruction,
+  const void * field)
+{
+  serialize_field<T>(instruction.member, const_cast<void *>(field), ser);
+}
+
+template<typename T, typename MemberType>
+void plan_deserialize_member(
+  eprosima::fastcdr::Cdr & deser, const PlanInstruction<MemberType> & instruction, void * field)
+{
+  deserialize_field<T>(instruction.member, field, deser);
+}
+
+template<typename T, typename MemberType>
+size_t plan_estimate_sequence(
+  const PlanInstruction<MemberType> & instruction, const void * field, size_t current_alignment)
+{
+  return next_field_align<T>(instruction.member, const_cast<void *>(field), current_alignment);
+}
+
+template<typename T, typename MemberType>
+size_t plan_estimate_string(
+  const PlanInstruction<MemberType> & instruction, const void * field, size_t current_alignment)
+{
+  return next_field_align_string<T>(
+    instruction.member, const_cast<void *>(field), current_alignment);
+}
+
+template<typename MembersType>
+template<typename T>
+void TypeSupport<MembersType>::appendPrimitive(const MemberType * member, size_t offset)
+{
+  Instruction instruction{};
+  instruction.offset = offset;
+  instruction.count = 1;
+  instruction.alignment = sizeof(T);
+  instruction.member = member;
+  if (!member->is_array_ || (member->array_size_ && !member->is_upper_bound_)) {
+    instruction.op = std::is_same<T, bool>::value ? PlanOp::BOOL : PlanOp::PRIMITIVE;
+    if (member->is_array_) {
+      instruction.count = member->array_size_;
+    }
+  } else {
+    instruction.op = PlanOp::FIELD;
+    instruction.serialize = &plan_serialize_member<T, MemberType>;
+    instruction.deserialize = &plan_deserialize_member<T, MemberType>;
+    instruction.estimate = &plan_estimate_sequence<T, MemberType>;
+  }
+  plan_.push_back(instruction);
+}
+
 template<typename MembersType>
-bool TypeSupport<MembersType>::deserializeROSmessage(
-  eprosima::fastcdr::Cdr & deser,
-  const MembersType * members,
-  void * ros_message) const
+template<typename T>
+void TypeSupport<MembersType>::appendString(const MemberType * member, size_t offset)
+{
+  Instruction instruction{};
+  instruction.op = PlanOp::FIELD;
+  instruction.offset = offset;
+  instruction.count = 1;
+  instruction.alignment = 4;
+  instruction.member = member;
+  instruction.serialize = &plan_serialize_member<T, MemberType>;
+  instruction.deserialize = &plan_deserialize_member<T, MemberType>;
+  instruction.estimate = &plan_estimate_string<T, MemberType>;
+  plan_.push_back(instruction);
+}
+
+template<typename MembersType>
+void TypeSupport<MembersType>::compilePlan(const MembersType * members, size_t offset)
 {
   assert(members);
-  assert(ros_message);
 
   for (uint32_t i = 0; i < members->member_count_; ++i) {
     const auto * member = members->members_ + i;
-    void * field = static_cast<char *>(ros_message) + member->offset_;
+    const size_t field_offset = offset + member->offset_;
     switch (member->type_id_) {
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOL:
-        deserialize_field<bool>(member, field, deser);
+        appendPrimitive<bool>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_BYTE:
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT8:
-        deserialize_field<uint8_t>(member, field, deser);
+        appendPrimitive<uint8_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_CHAR:
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT8:
-        deserialize_field<char>(member, field, deser);
+        appendPrimitive<char>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT32:
-        deserialize_field<float>(member, field, deser);
+        appendPrimitive<float>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_FLOAT64:
-        deserialize_field<double>(member, field, deser);
+        appendPrimitive<double>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT16:
-        deserialize_field<int16_t>(member, field, deser);
+        appendPrimitive<int16_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT16:
-        deserialize_field<uint16_t>(member, field, deser);
+        appendPrimitive<uint16_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT32:
-        deserialize_field<int32_t>(member, field, deser);
+        appendPrimitive<int32_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT32:
-        deserialize_field<uint32_t>(member, field, deser);
+        appendPrimitive<uint32_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_INT64:
-        deserialize_field<int64_t>(member, field, deser);
+        appendPrimitive<int64_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_UINT64:
-        deserialize_field<uint64_t>(member, field, deser);
+        appendPrimitive<uint64_t>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
-        deserialize_field<std::string>(member, field, deser);
+        appendString<std::string>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
-        deserialize_field<std::wstring>(member, field, deser);
+        appendString<std::wstring>(member, field_offset);
         break;
       case ::rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
         {
           auto sub_members = static_cast<const MembersType *>(member->members_->data);
           if (!member->is_array_) {
-            if (!deserializeROSmessage(deser, sub_members, field)) {
-              return false;
-            }
+            // The members of a nested message are run as members of this one.
+            compilePlan(sub_members, field_offset);
+            break;
+          }
+          Instruction instruction{};
+          instruction.offset = field_offset;
+          instruction.member = member;
+          if (member->array_size_ && !member->is_upper_bound_) {
+            instruction.op = PlanOp::MESSAGE_ARRAY;
+            instruction.count = member->array_size_;
+            instruction.stride = sub_members->size_of_;
           } else {
-            size_t array_size = 0;
-
-            if (member->array_size_ && !member->is_upper_bound_) {
-              array_size = member->array_size_;
-            } else {
-              uint32_t num_elems = 0;
-              deser >> num_elems;
-              array_size = static_cast<size_t>(num_elems);
-
-              if (!member->resize_function) {
-                RMW_SET_ERROR_MSG("unexpected error: resize function is null");
-                return false;
-              }
-              member->resize_function(field, array_size);
+            instruction.op = PlanOp::MESSAGE_SEQUENCE;
+          }
+          const size_t index = plan_.size();
+          plan_.push_back(instruction);
+          compilePlan(sub_members, 0);
+          plan_[index].end = plan_.size();
+        }
+        break;
+      default:
+        throw std::runtime_error("unknown type");
+    }
+  }
+}
+
+// Whether the primitives of `next` follow those of `previous` in memory with the padding CDR has
+// between them, and not, e.g., with the padding at the end of a nested message.
+template<typename MemberType>
+inline bool follows_as_in_cdr(
+  const PlanInstruction<MemberType> & previous, const PlanInstruction<MemberType> & next)
+{
+  const size_t end = previous.offset + previous.alignment * previous.count;
+  return next.offset == end + plan_alignment(end, next.alignment);
+}
+
+template<typename MembersType>
+void TypeSupport<MembersType>::coalescePlan()
+{
+  // Runs stop where the elements of an array of messages end, as what follows is at offsets of
+  // another message.
+  std::vector<bool> is_end(plan_.size() + 1, false);
+  for (const Instruction & instruction : plan_) {
+    if (PlanOp::MESSAGE_ARRAY == instruction.op || PlanOp::MESSAGE_SEQUENCE == instruction.op) {
+      is_end[instruction.end] = true;
+    }
+  }
+
+  std::vector<Instruction> plan;
+  plan.reserve(plan_.size());
+  // Index in the new plan of each instruction, or of the block it starts, to move the ends.
+  std::vector<size_t> new_index(plan_.size() + 1);
+  size_t i = 0;
+  while (i < plan_.size()) {
+    new_index[i] = plan.size();
+    size_t run_end = i + 1;
+    size_t block_alignment = plan_[i].alignment;
+    if (PlanOp::PRIMITIVE == plan_[i].op) {
+      while (run_end < plan_.size() && !is_end[run_end] &&
+        PlanOp::PRIMITIVE == plan_[run_end].op &&
+        follows_as_in_cdr(plan_[run_end - 1], plan_[run_end]))
+      {
+        block_alignment = std::max(block_alignment, plan_[run_end].alignment);
+        ++run_end;
+      }
+    }
+    // A single primitive or array is already copied at once.
+    if (run_end - i > 1) {
+      const Instruction & last = plan_[run_end - 1];
+      Instruction block{};
+      block.op = PlanOp::BLOCK;
+      block.offset = plan_[i].offset;
+      block.count = last.offset + last.alignment * last.count - block.offset;
+      block.alignment = plan_[i].alignment;
+      block.block_alignment = block_alignment;
+      block.end = run_end;
+      plan.push_back(block);
+    }
+    plan.push_back(plan_[i]);
+    for (++i; i < run_end; ++i) {
+      new_index[i] = plan.size();
+      plan.push_back(plan_[i]);
+    }
+  }
+  new_index[plan_.size()] = plan.size();
+
+  for (Instruction & instruction : plan) {
+    if (PlanOp::BLOCK == instruction.op || PlanOp::MESSAGE_ARRAY == instruction.op ||
+      PlanOp::MESSAGE_SEQUENCE == instruction.op)
+    {
+      instruction.end = new_index[instruction.end];
+    }
+  }
+  plan_.swap(plan);
+}
+
+template<typename MembersType>
+bool TypeSupport<MembersType>::planCopiesWholeMessage() const
+{
+  if (plan_.empty() || 0u != plan_[0].offset) {
+    return false;
+  }
+  const Instruction & first = plan_[0];
+  if (PlanOp::BLOCK == first.op) {
+    return plan_.size() == first.end && members_->size_of_ == first.count;
+  }
+  return 1u == plan_.size() && PlanOp::PRIMITIVE == first.op &&
+         members_->size_of_ == first.alignment * first.count;
+}
+
+// Whether a block starting at `position` of the stream, relative to where its alignment starts,
+// has the padding it has in memory.
+template<typename MemberType>
+inline bool block_fits(const PlanInstruction<MemberType> & block, size_t position)
+{
+  return 0u == ((position - block.offset) & (block.block_alignment - 1u));
+}
+
+template<typename MembersType>
+size_t TypeSupport<MembersType>::estimatePlan(
+  size_t begin, size_t end, const void * ros_message, size_t current_alignment) const
+{
+  assert(ros_message);
+
+  const char * base = static_cast<const char *>(ros_message);
+  for (size_t i = begin; i < end; ++i) {
+    const Instruction & instruction = plan_[i];
+    const char * field = base + instruction.offset;
+    switch (instruction.op) {
+      case PlanOp::PRIMITIVE:
+      case PlanOp::BOOL:
+        current_alignment += plan_alignment(current_alignment, instruction.alignment) +
+          instruction.alignment * instruction.count;
+        break;
+      case PlanOp::BLOCK:
+        {
+          const size_t position =
+            current_alignment + plan_alignment(current_alignment, instruction.alignment);
+          if (block_fits(instruction, position)) {
+            current_alignment = position + instruction.count;
+            i = instruction.end - 1;
+          }
+        }
+        break;
+      case PlanOp::FIELD:
+        current_alignment = instruction.estimate(instruction, field, current_alignment);
+        break;
+      case PlanOp::MESSAGE_ARRAY:
+        for (size_t index = 0; index < instruction.count; ++index) {
+          current_alignment = estimatePlan(
+            i + 1, instruction.end, field + index * instruction.stride, current_alignment);
+        }
+        i = instruction.end - 1;
+        break;
+      case PlanOp::MESSAGE_SEQUENCE:
+        {
+          const auto * member = instruction.member;
+          if (!member->size_function) {
+            RMW_SET_ERROR_MSG("unexpected error: size function is null");
+            return current_alignment;
+          }
+          void * sequence = const_cast<char *>(field);
+          size_t array_size = member->size_function(sequence);
+
+          // Length serialization
+          current_alignment += 4 + eprosima::fastcdr::Cdr::alignment(current_alignment, 4);
+
+          if (array_size != 0 && !member->get_function) {
+            RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
+            return current_alignment;
+          }
+          for (size_t index = 0; index < array_size; ++index) {
+            current_alignment = estimatePlan(
+              i + 1, instruction.end, member->get_function(sequence, index), current_alignment);
+          }
+          i = instruction.end - 1;
+        }
+        break;
+    }
+  }
+
+  return current_alignment;
+}
+
+template<typename MembersType>
+bool TypeSupport<MembersType>::serializePlan(
+  eprosima::fastcdr::Cdr & ser, size_t begin, size_t end, const void * ros_message,
+  size_t origin) const
+{
+  assert(ros_message);
+
+  const char * base = static_cast<const char *>(ros_message);
+  for (size_t i = begin; i < end; ++i) {
+    const Instruction & instruction = plan_[i];
+    const char * field = base + instruction.offset;
+    switch (instruction.op) {
+      case PlanOp::PRIMITIVE:
+        serialize_primitives(ser, field, instruction.alignment, instruction.count);
+        break;
+      case PlanOp::BOOL:
+        if (!instruction.member->is_array_) {
+          // don't cast to bool here because if the bool is
+          // uninitialized the random value can't be deserialized
+          ser << (*reinterpret_cast<const uint8_t *>(field) ? true : false);
+        } else {
+          ser.serializeArray(reinterpret_cast<const bool *>(field), instruction.count);
+        }
+        break;
+      case PlanOp::BLOCK:
+        if (eprosima::fastcdr::Cdr::DEFAULT_ENDIAN == ser.endianness()) {
+          const size_t position = ser.getSerializedDataLength() - origin;
+          const size_t padding = plan_alignment(position, instruction.alignment);
+          if (block_fits(instruction, position + padding)) {
+            if (!ser.jump(padding)) {
+              throw eprosima::fastcdr::exception::NotEnoughMemoryException(
+                eprosima::fastcdr::exception::NotEnoughMemoryException::
+                NOT_ENOUGH_MEMORY_MESSAGE_DEFAULT);
             }
+            ser.serializeArray(reinterpret_cast<const uint8_t *>(field), instruction.count);
+            i = instruction.end - 1;
+          }
+        }
+        break;
+      case PlanOp::FIELD:
+        instruction.serialize(ser, instruction, field);
+        break;
+      case PlanOp::MESSAGE_ARRAY:
+        for (size_t index = 0; index < instruction.count; ++index) {
+          if (!serializePlan(
+              ser, i + 1, instruction.end, field + index * instruction.stride, origin))
+          {
+            return false;
+          }
+        }
+        i = instruction.end - 1;
+        break;
+      case PlanOp::MESSAGE_SEQUENCE:
+        {
+          const auto * member = instruction.member;
+          if (!member->size_function) {
+            RMW_SET_ERROR_MSG("unexpected error: size function is null");
+            return false;
+          }
+          void * sequence = const_cast<char *>(field);
+          size_t array_size = member->size_function(sequence);
+
+          // Serialize length
+          ser << (uint32_t)array_size;
 
-            if (array_size != 0 && !member->get_function) {
-              RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
+          if (array_size != 0 && !member->get_function) {
+            RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
+            return false;
+          }
+          for (size_t index = 0; index < array_size; ++index) {
+            if (!serializePlan(
+                ser, i + 1, instruction.end, member->get_function(sequence, index), origin))
+            {
               return false;
             }
-            for (size_t index = 0; index < array_size; ++index) {
-              if (!deserializeROSmessage(deser, sub_members, member->get_function(field, index))) {
-                return false;
-              }
+          }
+          i = instruction.end - 1;
+        }
+        break;
+    }
+  }
+
+  return true;
+}
+
+template<typename MembersType>
+bool TypeSupport<MembersType>::deserializePlan(
+  eprosima::fastcdr::Cdr & deser, size_t begin, size_t end, void * ros_message,
+  size_t origin) const
+{
+  assert(ros_message);
+
+  char * base = static_cast<char *>(ros_message);
+  for (size_t i = begin; i < end; ++i) {
+    const Instruction & instruction = plan_[i];
+    char * field = base + instruction.offset;
+    switch (instruction.op) {
+      case PlanOp::PRIMITIVE:
+        deserialize_primitives(deser, field, instruction.alignment, instruction.count);
+        break;
+      case PlanOp::BOOL:
+        deser.deserializeArray(reinterpret_cast<bool *>(field), instruction.count);
+        break;
+      case PlanOp::BLOCK:
+        if (eprosima::fastcdr::Cdr::DEFAULT_ENDIAN == deser.endianness()) {
+          const size_t position = deser.getSerializedDataLength() - origin;
+          const size_t padding = plan_alignment(position, instruction.alignment);
+          if (block_fits(instruction, position + padding)) {
+            if (!deser.jump(padding)) {
+              throw eprosima::fastcdr::exception::NotEnoughMemoryException(
+                eprosima::fastcdr::exception::NotEnoughMemoryException::
+                NOT_ENOUGH_MEMORY_MESSAGE_DEFAULT);
             }
+            deser.deserializeArray(reinterpret_cast<uint8_t *>(field), instruction.count);
+            i = instruction.end - 1;
           }
         }
         break;
-      default:
-        throw std::runtime_error("unknown type");
+      case PlanOp::FIELD:
+        instruction.deserialize(deser, instruction, field);
+        break;
+      case PlanOp::MESSAGE_ARRAY:
+        for (size_t index = 0; index < instruction.count; ++index) {
+          if (!deserializePlan(
+              deser, i + 1, instruction.end, field + index * instruction.stride, origin))
+          {
+            return false;
+          }
+        }
+        i = instruction.end - 1;
+        break;
+      case PlanOp::MESSAGE_SEQUENCE:
+        {
+          const auto * member = instruction.member;
+          // Messages are serialized with at least one byte, empty ones have a placeholder field
+          size_t array_size = deserialize_sequence_length(deser, 1u);
+
+          if (!member->resize_function) {
+            RMW_SET_ERROR_MSG("unexpected error: resize function is null");
+            return false;
+          }
+          // Resizing C sequences reallocates them, so keep the ones of the right size
+          if (!member->size_function || member->size_function(field) != array_size) {
+            member->resize_function(field, array_size);
+          }
+
+          if (array_size != 0 && !member->get_function) {
+            RMW_SET_ERROR_MSG("unexpected error: get_function function is null");
+            return false;
+          }
+          for (size_t index = 0; index < array_size; ++index) {
+            if (!deserializePlan(
+                deser, i + 1, instruction.end, member->get_function(field, index), origin))
+            {
+              return false;
+            }
+          }
+          i = instruction.end - 1;
+        }
+        break;
     }
   }
 
@@ -915,7 +1212,7 @@ size_t TypeSupport<MembersType>::getEstimatedSerializedSize(
 
   (void)impl;
   if (members_->member_count_ != 0) {
-    ret_val += TypeSupport::getEstimatedSerializedSize(members_, ros_message, 0);
+    ret_val += estimatePlan(0, plan_.size(), ros_message, 0);
   } else {
     ret_val += 1;
   }
@@ -932,13 +1229,14 @@ bool TypeSupport<MembersType>::serializeROSmessage(
 
   // Serialize encapsulation
   ser.serialize_encapsulation();
+  // CDR alignment is relative to the end of the encapsulation
+  const size_t origin = ser.getSerializedDataLength();
 
   (void)impl;
   if (members_->member_count_ != 0) {
-    TypeSupport::serializeROSmessage(ser, members_, ros_message);
-  } else {
-    ser << (uint8_t)0;
+    return serializePlan(ser, 0, plan_.size(), ros_message, origin);
   }
+  ser << (uint8_t)0;
 
   return true;
 }
@@ -953,10 +1251,12 @@ bool TypeSupport<MembersType>::deserializeROSmessage(
   try {
     // Deserialize encapsulation.
     deser.read_encapsulation();
+    // CDR alignment is relative to the end of the encapsulation
+    const size_t origin = deser.getSerializedDataLength();
 
     (void)impl;
     if (members_->member_count_ != 0) {
-      return TypeSupport::deserializeROSmessage(deser, members_, ros_message);
+      return deserializePlan(deser, 0, plan_.size(), ros_message, origin);
     }
 
     uint8_t dump = 0;
@@ -0,0 +1,186 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_DYNAMIC_CPP__BYTE_SWAP_HPP_
+#define RMW_FASTRTPS_DYNAMIC_CPP__BYTE_SWAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace rmw_fastrtps_dynamic_cpp
+{
+
+namespace detail
+{
+
+inline uint8_t
+byte_swap(uint8_t value)
+{
+  return value;
+}
+
+inline uint16_t
+byte_swap(uint16_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_ushort(value);
+#else
+  return __builtin_bswap16(value);
+#endif
+}
+
+inline uint32_t
+byte_swap(uint32_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_ulong(value);
+#else
+  return __builtin_bswap32(value);
+#endif
+}
+
+inline uint64_t
+byte_swap(uint64_t value)
+{
+#if defined(_MSC_VER)
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
+template<size_t Size>
+struct UnsignedOfSize;
+
+template<>
+struct UnsignedOfSize<1>
+{
+  using type = uint8_t;
+};
+
+template<>
+struct UnsignedOfSize<2>
+{
+  using type = uint16_t;
+};
+
+template<>
+struct UnsignedOfSize<4>
+{
+  using type = uint32_t;
+};
+
+template<>
+struct UnsignedOfSize<8>
+{
+  using type = uint64_t;
+};
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+// Shuffle reversing the bytes of each element of `Size` bytes of a 16 byte block.
+template<size_t Size>
+inline __m128i
+reverse_shuffle_mask()
+{
+  alignas(16) uint8_t mask[16];
+  for (size_t i = 0; i < 16; ++i) {
+    mask[i] = static_cast<uint8_t>((i / Size) * Size + (Size - 1 - i % Size));
+  }
+  return _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+}
+#endif
+
+// Reverse the bytes of each of `count` elements of `Size` bytes, a whole vector register at a
+// time when the target has SIMD instructions to shuffle bytes, and the rest one at a time.
+template<size_t Size>
+inline void
+swap_elements(uint8_t * data, size_t count)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i mask = _mm256_broadcastsi128_si256(reverse_shuffle_mask<Size>());
+  for (; i + 32 / Size <= count; i += 32 / Size) {
+    auto block = reinterpret_cast<__m256i *>(data + i * Size);
+    _mm256_storeu_si256(block, _mm256_shuffle_epi8(_mm256_loadu_si256(block), mask));
+  }
+#elif defined(__SSSE3__)
+  const __m128i mask = reverse_shuffle_mask<Size>();
+  for (; i + 16 / Size <= count; i += 16 / Size) {
+    auto block = reinterpret_cast<__m128i *>(data + i * Size);
+    _mm_storeu_si128(block, _mm_shuffle_epi8(_mm_loadu_si128(block), mask));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 16 / Size <= count; i += 16 / Size) {
+    uint8_t * block = data + i * Size;
+    uint8x16_t bytes = vld1q_u8(block);
+    switch (Size) {
+      case 2:
+        bytes = vrev16q_u8(bytes);
+        break;
+      case 4:
+        bytes = vrev32q_u8(bytes);
+        break;
+      default:
+        bytes = vrev64q_u8(bytes);
+        break;
+    }
+    vst1q_u8(block, bytes);
+  }
+#endif
+  // Elements are copied in and out, as they may not be aligned in the buffer.
+  using Unsigned = typename UnsignedOfSize<Size>::type;
+  for (; i < count; ++i) {
+    Unsigned element;
+    memcpy(&element, data + i * Size, Size);
+    element = byte_swap(element);
+    memcpy(data + i * Size, &element, Size);
+  }
+}
+
+}  // namespace detail
+
+/// Reverse in place the byte order of each of the `count` primitives at `data`.
+/**
+ * This converts an array between little and big endianness much faster than swapping the
+ * elements one at a time, as is done by Fast CDR.
+ * Arrays of single bytes are left as they are.
+ */
+template<typename T>
+inline void
+byte_swap_array(T * data, size_t count)
+{
+  static_assert(
+    sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
+    "only primitives of 1, 2, 4 or 8 bytes can have their bytes swapped");
+  if (sizeof(T) > 1) {
+    detail::swap_elements<sizeof(T)>(reinterpret_cast<uint8_t *>(data), count);
+  }
+}
+
+}  // namespace rmw_fastrtps_dynamic_cpp
+
+#endif  // RMW_FASTRTPS_DYNAMIC_CPP__BYTE_SWAP_HPP_
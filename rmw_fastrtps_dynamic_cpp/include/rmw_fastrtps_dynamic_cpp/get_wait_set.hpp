@@ -0,0 +1,84 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_DYNAMIC_CPP__GET_WAIT_SET_HPP_
+#define RMW_FASTRTPS_DYNAMIC_CPP__GET_WAIT_SET_HPP_
+
+#include <cstdint>
+
+#include "rmw/rmw.h"
+#include "rmw_fastrtps_dynamic_cpp/visibility_control.h"
+
+namespace rmw_fastrtps_dynamic_cpp
+{
+
+/// Return a file descriptor which is readable when entities of the wait set may be ready.
+/**
+ * See rmw_fastrtps_shared_cpp::__rmw_wait_set_get_fd() for how to use it.
+ * The function returns `-1` when either the wait set handle is `NULL`, when the wait set
+ * handle is from a different rmw implementation, or when the descriptor cannot be created
+ * (e.g. on platforms other than Linux).
+ *
+ * \return file descriptor owned by the wait set if successful, otherwise `-1`
+ */
+RMW_FASTRTPS_DYNAMIC_CPP_PUBLIC
+int
+get_wait_set_fd(rmw_wait_set_t * wait_set);
+
+/// Set for how long rmw_wait() busy-polls a wait set before blocking.
+/**
+ * See rmw_fastrtps_shared_cpp::__rmw_wait_set_set_spin_period() for details.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `wait_set` or `spin_period` is NULL, or if the period
+ *   is two seconds or more, or if its nanoseconds make a second or more, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_DYNAMIC_CPP_PUBLIC
+rmw_ret_t
+set_wait_set_spin_period(rmw_wait_set_t * wait_set, const rmw_time_t * spin_period);
+
+/// Get how many rmw_wait() calls on a wait set found ready entities by polling or by blocking.
+/**
+ * See rmw_fastrtps_shared_cpp::__rmw_wait_set_get_wakeup_counts() for details.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_DYNAMIC_CPP_PUBLIC
+rmw_ret_t
+get_wait_set_wakeup_counts(
+  const rmw_wait_set_t * wait_set,
+  uint64_t * spin_wakeups,
+  uint64_t * block_wakeups);
+
+/// Get how many notifications the entities of a wait set skipped while attached to it.
+/**
+ * See rmw_fastrtps_shared_cpp::__rmw_wait_set_get_suppressed_notification_count() for details.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_DYNAMIC_CPP_PUBLIC
+rmw_ret_t
+get_wait_set_suppressed_notification_count(const rmw_wait_set_t * wait_set, uint64_t * count);
+
+}  // namespace rmw_fastrtps_dynamic_cpp
+
+#endif  // RMW_FASTRTPS_DYNAMIC_CPP__GET_WAIT_SET_HPP_
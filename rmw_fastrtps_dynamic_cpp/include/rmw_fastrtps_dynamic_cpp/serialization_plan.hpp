@@ -0,0 +1,89 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_DYNAMIC_CPP__SERIALIZATION_PLAN_HPP_
+#define RMW_FASTRTPS_DYNAMIC_CPP__SERIALIZATION_PLAN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fastcdr/Cdr.h"
+
+namespace rmw_fastrtps_dynamic_cpp
+{
+
+/// Kind of an instruction of a serialization plan.
+enum class PlanOp : uint8_t
+{
+  /// A primitive other than a boolean, or a fixed size array of them.
+  PRIMITIVE,
+  /// A boolean, or a fixed size array of them.
+  BOOL,
+  /// A run of PRIMITIVE instructions laid out in memory as in CDR, followed by them.
+  BLOCK,
+  /// A string or a sequence, run through the functions of the instruction.
+  FIELD,
+  /// A fixed size array of messages, followed by the instructions of the members of an element.
+  MESSAGE_ARRAY,
+  /// A sequence of messages, followed by the instructions of the members of an element.
+  MESSAGE_SEQUENCE,
+};
+
+/// Instruction of the flat serialization plan of a type.
+/**
+ * The members of a type are walked once, when its type support is created, and turned into a
+ * list of these instructions.
+ * Nested messages are inlined at the offset they have in the outer message, so that serializing,
+ * deserializing or estimating the size of a message only goes through that list, without looking
+ * at the introspection members again.
+ * Arrays and sequences of messages are followed by the instructions of their elements, which are
+ * run for each element, with offsets from the start of that element.
+ *
+ * Consecutive primitives which are padded in memory as they are in CDR are preceded by a block
+ * instruction, which copies them at once when the stream has the endianness of the host and
+ * starts the block at an alignment which gives it the same padding.
+ * Otherwise, the block is skipped and its fields are run one at a time.
+ */
+template<typename MemberType>
+struct PlanInstruction
+{
+  PlanOp op;
+  /// Offset of the field from the start of the message, or of the array element, being run.
+  size_t offset;
+  /// Number of elements of a fixed size array, 1 for a single field, or the size of a block.
+  size_t count;
+  /// CDR alignment of the elements, which is their size for primitives.
+  size_t alignment;
+  /// Size in memory of the elements of an array of messages.
+  size_t stride;
+  /// Index of the instruction following the members of the elements of an array of messages,
+  /// or the fields of a block.
+  size_t end;
+  /// Largest alignment of the fields of a block.
+  size_t block_alignment;
+  /// Introspection member, for the fields which need its functions or bounds.
+  const MemberType * member;
+
+  /// Functions of a FIELD instruction.
+  void (* serialize)(
+    eprosima::fastcdr::Cdr & ser, const PlanInstruction & instruction, const void * field);
+  void (* deserialize)(
+    eprosima::fastcdr::Cdr & deser, const PlanInstruction & instruction, void * field);
+  size_t (* estimate)(
+    const PlanInstruction & instruction, const void * field, size_t current_alignment);
+};
+
+}  // namespace rmw_fastrtps_dynamic_cpp
+
+#endif  // RMW_FASTRTPS_DYNAMIC_CPP__SERIALIZATION_PLAN_HPP_
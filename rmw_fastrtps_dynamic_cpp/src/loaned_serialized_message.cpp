@@ -0,0 +1,43 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_fastrtps_dynamic_cpp/loaned_serialized_message.hpp"
+
+#include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
+#include "rmw_fastrtps_dynamic_cpp/identifier.hpp"
+
+namespace rmw_fastrtps_dynamic_cpp
+{
+
+rmw_ret_t
+take_loaned_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_take_loaned_serialized_message(
+    eprosima_fastrtps_identifier, subscription, loaned_message, taken, message_info);
+}
+
+rmw_ret_t
+return_loaned_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * loaned_message)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_return_loaned_serialized_message_from_subscription(
+    eprosima_fastrtps_identifier, subscription, loaned_message);
+}
+
+}  // namespace rmw_fastrtps_dynamic_cpp
@@ -0,0 +1,35 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_fastrtps_dynamic_cpp/publish_many.hpp"
+
+#include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
+#include "rmw_fastrtps_dynamic_cpp/identifier.hpp"
+
+namespace rmw_fastrtps_dynamic_cpp
+{
+
+rmw_ret_t
+publish_many(
+  const rmw_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation)
+{
+  return rmw_fastrtps_shared_cpp::__rmw_publish_many(
+    eprosima_fastrtps_identifier, publisher, ros_messages, count, published, allocation);
+}
+
+}  // namespace rmw_fastrtps_dynamic_cpp
@@ -35,6 +35,7 @@
 
 #include "rcpputils/scope_exit.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_participant_info.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_publisher_info.hpp"
 #include "rmw_fastrtps_shared_cpp/names.hpp"
@@ -211,6 +212,8 @@ rmw_fastrtps_dynamic_cpp::create_publisher(
   }
 
   info->type_support_ = fastdds_type;
+  info->serialize_in_single_pass_ =
+    participant_info->single_pass_serialization && !fastdds_type->is_bounded();
 
   /////
   // Create Listener
@@ -274,6 +277,19 @@ rmw_fastrtps_dynamic_cpp::create_publisher(
     return nullptr;
   }
 
+  if (!participant_info->leave_middleware_default_qos &&
+    participant_info->data_sharing_mode != data_sharing_mode_t::OFF)
+  {
+    enable_data_sharing_if_supported(
+      info->type_support_, topic_name,
+      participant_info->data_sharing_mode == data_sharing_mode_t::AUTO,
+      participant_info->data_sharing_domain_ids, writer_qos);
+  }
+
+  info->compression_ = rmw_fastrtps_shared_cpp::get_compression_settings(
+    writer_qos, participant_info->compression_threshold, topic_name);
+  info->decompressing_readers_ = participant_info->decompressing_readers_;
+
   // Creates DataWriter (with publisher name to not change name policy)
   info->data_writer_ = publisher->create_datawriter(
     topic.topic,
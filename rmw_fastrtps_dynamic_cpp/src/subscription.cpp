@@ -34,6 +34,7 @@
 
 #include "rcpputils/scope_exit.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_participant_info.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_subscriber_info.hpp"
 #include "rmw_fastrtps_shared_cpp/names.hpp"
@@ -266,6 +267,19 @@ create_subscription(
     return nullptr;
   }
 
+  if (!participant_info->leave_middleware_default_qos &&
+    participant_info->data_sharing_mode != data_sharing_mode_t::OFF)
+  {
+    enable_data_sharing_if_supported(
+      info->type_support_, topic_name,
+      participant_info->data_sharing_mode == data_sharing_mode_t::AUTO,
+      participant_info->data_sharing_domain_ids, reader_qos);
+  }
+
+  if (rmw_fastrtps_shared_cpp::advertise_decompression(reader_qos)) {
+    info->decompressing_readers_ = participant_info->decompressing_readers_;
+  }
+
   info->listener_ = new (std::nothrow) SubListener(info, qos_policies->depth);
   if (!info->listener_) {
     RMW_SET_ERROR_MSG("create_subscriber() could not create subscriber listener");
@@ -324,6 +338,10 @@ create_subscription(
   info->subscription_gid_ = rmw_fastrtps_shared_cpp::create_rmw_gid(
     eprosima_fastrtps_identifier, info->data_reader_->guid());
 
+  if (info->decompressing_readers_) {
+    info->decompressing_readers_->add(info->data_reader_->guid());
+  }
+
   rmw_subscription_t * rmw_subscription = rmw_subscription_allocate();
   if (!rmw_subscription) {
     RMW_SET_ERROR_MSG("create_subscription() failed to allocate subscription");
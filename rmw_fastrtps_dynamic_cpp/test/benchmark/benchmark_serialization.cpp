@@ -0,0 +1,160 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "fastcdr/Cdr.h"
+#include "fastcdr/FastBuffer.h"
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "rmw_fastrtps_dynamic_cpp/MessageTypeSupport.hpp"
+#include "rmw_fastrtps_dynamic_cpp/MessageTypeSupport_impl.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+using Members = rosidl_typesupport_introspection_cpp::MessageMembers;
+
+// Type support with the runs of primitives copied at once, as used by the rmw.
+using BlockTypeSupport = rmw_fastrtps_dynamic_cpp::MessageTypeSupport<Members>;
+
+// Type support running the same plan without block instructions, one field at a time.
+class FieldByFieldTypeSupport : public rmw_fastrtps_dynamic_cpp::MessageTypeSupport<Members>
+{
+public:
+  FieldByFieldTypeSupport(const Members * members, const void * ros_type_support)
+  : MessageTypeSupport(members, ros_type_support)
+  {
+    this->plan_.clear();
+    this->compilePlan(this->members_, 0);
+  }
+};
+
+template<typename MessageT>
+const Members *
+get_members()
+{
+  const rosidl_message_type_support_t * ts = get_message_typesupport_handle(
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>(),
+    rosidl_typesupport_introspection_cpp::typesupport_identifier);
+  return static_cast<const Members *>(ts->data);
+}
+
+}  // namespace
+
+class SerializationPerformanceTest : public PerformanceTest
+{
+protected:
+  template<typename TypeSupportT, typename MessageT>
+  void serialize(benchmark::State & st, const MessageT & message)
+  {
+    TypeSupportT type_support(get_members<MessageT>(), nullptr);
+    std::vector<char> buffer(type_support.getEstimatedSerializedSize(&message, nullptr));
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+      eprosima::fastcdr::Cdr ser(
+        fastbuffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+      if (!type_support.serializeROSmessage(&message, ser, nullptr)) {
+        st.SkipWithError("serializeROSmessage failed");
+        break;
+      }
+      benchmark::ClobberMemory();
+    }
+    st.SetBytesProcessed(static_cast<int64_t>(st.iterations() * buffer.size()));
+  }
+
+  template<typename TypeSupportT, typename MessageT>
+  void deserialize(benchmark::State & st, const MessageT & message)
+  {
+    TypeSupportT type_support(get_members<MessageT>(), nullptr);
+    std::vector<char> buffer(type_support.getEstimatedSerializedSize(&message, nullptr));
+    {
+      eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+      eprosima::fastcdr::Cdr ser(
+        fastbuffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+      if (!type_support.serializeROSmessage(&message, ser, nullptr)) {
+        st.SkipWithError("serializeROSmessage failed");
+        return;
+      }
+    }
+    // Deserialize into a message which already has the sizes of the sequences
+    MessageT output = message;
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+      eprosima::fastcdr::Cdr deser(
+        fastbuffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+      if (!type_support.deserializeROSmessage(deser, &output, nullptr)) {
+        st.SkipWithError("deserializeROSmessage failed");
+        break;
+      }
+      benchmark::ClobberMemory();
+    }
+    st.SetBytesProcessed(static_cast<int64_t>(st.iterations() * buffer.size()));
+  }
+};
+
+BENCHMARK_F(SerializationPerformanceTest, serialize_basic_types_block)(benchmark::State & st)
+{
+  serialize<BlockTypeSupport>(st, *get_messages_basic_types()[1]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, serialize_basic_types_fields)(benchmark::State & st)
+{
+  serialize<FieldByFieldTypeSupport>(st, *get_messages_basic_types()[1]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, deserialize_basic_types_block)(benchmark::State & st)
+{
+  deserialize<BlockTypeSupport>(st, *get_messages_basic_types()[1]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, deserialize_basic_types_fields)(benchmark::State & st)
+{
+  deserialize<FieldByFieldTypeSupport>(st, *get_messages_basic_types()[1]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, serialize_arrays_block)(benchmark::State & st)
+{
+  serialize<BlockTypeSupport>(st, *get_messages_arrays()[0]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, serialize_arrays_fields)(benchmark::State & st)
+{
+  serialize<FieldByFieldTypeSupport>(st, *get_messages_arrays()[0]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, deserialize_arrays_block)(benchmark::State & st)
+{
+  deserialize<BlockTypeSupport>(st, *get_messages_arrays()[0]);
+}
+
+BENCHMARK_F(SerializationPerformanceTest, deserialize_arrays_fields)(benchmark::State & st)
+{
+  deserialize<FieldByFieldTypeSupport>(st, *get_messages_arrays()[0]);
+}
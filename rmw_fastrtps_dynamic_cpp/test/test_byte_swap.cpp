@@ -0,0 +1,108 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "fastcdr/Cdr.h"
+#include "fastcdr/FastBuffer.h"
+
+#include "rmw_fastrtps_dynamic_cpp/TypeSupport.hpp"
+#include "rmw_fastrtps_dynamic_cpp/byte_swap.hpp"
+
+namespace
+{
+
+template<typename T>
+void
+check_byte_swap_array()
+{
+  // Lengths around the sizes of the vector registers, and unaligned starts.
+  for (size_t count = 0; count < 70; ++count) {
+    for (size_t offset = 0; offset < 3; ++offset) {
+      std::vector<uint8_t> buffer(offset + count * sizeof(T) + 8);
+      for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(i * 7 + 1);
+      }
+      std::vector<uint8_t> expected = buffer;
+      for (size_t i = 0; i < count; ++i) {
+        for (size_t b = 0; b < sizeof(T); ++b) {
+          expected[offset + i * sizeof(T) + b] = buffer[offset + (i + 1) * sizeof(T) - 1 - b];
+        }
+      }
+      rmw_fastrtps_dynamic_cpp::byte_swap_array(
+        reinterpret_cast<T *>(buffer.data() + offset), count);
+      ASSERT_EQ(expected, buffer) << "count " << count << ", offset " << offset;
+    }
+  }
+}
+
+template<typename T>
+void
+check_deserialize_foreign_array(eprosima::fastcdr::Cdr::Endianness endianness)
+{
+  std::vector<T> values(37);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<T>(i * 1000 + 3);
+  }
+
+  eprosima::fastcdr::FastBuffer buffer;
+  eprosima::fastcdr::Cdr ser(buffer, endianness, eprosima::fastcdr::Cdr::DDS_CDR);
+  ser.serialize_encapsulation();
+  // Makes the array need some padding to be aligned.
+  ser << static_cast<uint8_t>(1);
+  ser << values;
+  ser << static_cast<uint32_t>(42);
+
+  eprosima::fastcdr::FastBuffer in(buffer.getBuffer(), ser.getSerializedDataLength());
+  eprosima::fastcdr::Cdr deser(
+    in, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+  deser.read_encapsulation();
+  uint8_t first = 0;
+  deser >> first;
+  std::vector<T> result;
+  rmw_fastrtps_dynamic_cpp::deserialize_sequence(deser, result);
+  uint32_t last = 0;
+  deser >> last;
+
+  EXPECT_EQ(1u, first);
+  EXPECT_EQ(values, result);
+  // The endianness of the payload is kept for what follows the array.
+  EXPECT_EQ(42u, last);
+}
+
+}  // namespace
+
+TEST(TestByteSwap, byte_swap_array) {
+  check_byte_swap_array<int16_t>();
+  check_byte_swap_array<uint32_t>();
+  check_byte_swap_array<float>();
+  check_byte_swap_array<double>();
+  check_byte_swap_array<uint64_t>();
+}
+
+TEST(TestByteSwap, deserialize_foreign_endianness) {
+  for (auto endianness : {eprosima::fastcdr::Cdr::BIG_ENDIANNESS,
+      eprosima::fastcdr::Cdr::LITTLE_ENDIANNESS})
+  {
+    check_deserialize_foreign_array<uint8_t>(endianness);
+    check_deserialize_foreign_array<int16_t>(endianness);
+    check_deserialize_foreign_array<int32_t>(endianness);
+    check_deserialize_foreign_array<float>(endianness);
+    check_deserialize_foreign_array<double>(endianness);
+    check_deserialize_foreign_array<uint64_t>(endianness);
+  }
+}
@@ -0,0 +1,304 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fastcdr/Cdr.h"
+#include "fastcdr/FastBuffer.h"
+
+#include "gtest/gtest.h"
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+#include "rmw/serialized_message.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_runtime_c/u16string_functions.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "rmw_fastrtps_dynamic_cpp/MessageTypeSupport.hpp"
+#include "rmw_fastrtps_dynamic_cpp/MessageTypeSupport_impl.hpp"
+
+#include "test_msgs/message_fixtures.hpp"
+#include "test_msgs/msg/unbounded_sequences.h"
+#include "test_msgs/msg/w_strings.h"
+
+namespace
+{
+
+// Serialize each message through the plan of its type, and check that it is deserialized the same.
+template<typename MessageT>
+void
+check_round_trip(const std::vector<std::shared_ptr<MessageT>> & messages)
+{
+  const rosidl_message_type_support_t * ts =
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>();
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  ASSERT_EQ(RMW_RET_OK, rmw_serialized_message_init(&serialized_message, 0u, &allocator));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&serialized_message));
+  });
+
+  for (const auto & message : messages) {
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_serialize(message.get(), ts, &serialized_message)) <<
+      rmw_get_error_string().str;
+    MessageT output;
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_deserialize(&serialized_message, ts, &output)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(*message, output);
+  }
+}
+
+using Members = rosidl_typesupport_introspection_cpp::MessageMembers;
+using BlockTypeSupport = rmw_fastrtps_dynamic_cpp::MessageTypeSupport<Members>;
+
+// Runs the plan without block instructions, one field at a time.
+class FieldByFieldTypeSupport : public rmw_fastrtps_dynamic_cpp::MessageTypeSupport<Members>
+{
+public:
+  FieldByFieldTypeSupport(const Members * members, const void * ros_type_support)
+  : MessageTypeSupport(members, ros_type_support)
+  {
+    this->plan_.clear();
+    this->compilePlan(this->members_, 0);
+  }
+};
+
+template<typename MessageT>
+std::vector<char>
+serialize(
+  const rmw_fastrtps_dynamic_cpp::TypeSupport<Members> & type_support, const MessageT & message,
+  eprosima::fastcdr::Cdr::Endianness endianness)
+{
+  std::vector<char> buffer(type_support.getEstimatedSerializedSize(&message, nullptr));
+  eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+  eprosima::fastcdr::Cdr ser(fastbuffer, endianness, eprosima::fastcdr::Cdr::DDS_CDR);
+  EXPECT_TRUE(type_support.serializeROSmessage(&message, ser, nullptr));
+  EXPECT_EQ(buffer.size(), ser.getSerializedDataLength());
+  return buffer;
+}
+
+template<typename MessageT>
+void
+check_deserialize(
+  const rmw_fastrtps_dynamic_cpp::TypeSupport<Members> & type_support,
+  std::vector<char> buffer, const MessageT & expected)
+{
+  eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+  eprosima::fastcdr::Cdr deser(
+    fastbuffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+  MessageT output;
+  ASSERT_TRUE(type_support.deserializeROSmessage(deser, &output, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(expected, output);
+}
+
+// Check that the messages copied in blocks are read field by field, and conversely, for both
+// endiannesses, in which case the blocks are not used.
+template<typename MessageT>
+void
+check_blocks_match_fields(const std::vector<std::shared_ptr<MessageT>> & messages)
+{
+  const rosidl_message_type_support_t * ts = get_message_typesupport_handle(
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>(),
+    rosidl_typesupport_introspection_cpp::typesupport_identifier);
+  ASSERT_NE(nullptr, ts);
+  auto members = static_cast<const Members *>(ts->data);
+  BlockTypeSupport blocks(members, ts);
+  FieldByFieldTypeSupport fields(members, ts);
+
+  for (auto endianness : {eprosima::fastcdr::Cdr::BIG_ENDIANNESS,
+      eprosima::fastcdr::Cdr::LITTLE_ENDIANNESS})
+  {
+    for (const auto & message : messages) {
+      EXPECT_EQ(
+        fields.getEstimatedSerializedSize(message.get(), nullptr),
+        blocks.getEstimatedSerializedSize(message.get(), nullptr));
+      check_deserialize(fields, serialize(blocks, *message, endianness), *message);
+      check_deserialize(blocks, serialize(fields, *message, endianness), *message);
+    }
+  }
+}
+
+// Whether the type support of the message reports it as plain.
+template<typename MessageT>
+bool
+is_plain()
+{
+  const rosidl_message_type_support_t * ts = get_message_typesupport_handle(
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>(),
+    rosidl_typesupport_introspection_cpp::typesupport_identifier);
+  EXPECT_NE(nullptr, ts);
+  if (nullptr == ts) {
+    return false;
+  }
+  BlockTypeSupport type_support(static_cast<const Members *>(ts->data), ts);
+  return type_support.is_plain();
+}
+
+// Serialize a test_msgs/UnboundedSequences message whose first `field` sequences are empty, and
+// whose next one claims a length much larger than the payload.
+rmw_serialized_message_t
+make_oversized_sequence(size_t field, std::vector<char> & buffer)
+{
+  buffer.assign(128u, 0);
+  eprosima::fastcdr::FastBuffer fastbuffer(buffer.data(), buffer.size());
+  eprosima::fastcdr::Cdr ser(
+    fastbuffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+  ser.serialize_encapsulation();
+  for (size_t i = 0; i < field; ++i) {
+    ser << static_cast<uint32_t>(0u);
+  }
+  ser << static_cast<uint32_t>(0xFFFFFFF0u);
+
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  serialized_message.buffer = reinterpret_cast<uint8_t *>(buffer.data());
+  serialized_message.buffer_length = buffer.size();
+  serialized_message.buffer_capacity = buffer.size();
+  return serialized_message;
+}
+
+// Number of sequences at the start of test_msgs/UnboundedSequences: the primitive ones, the
+// strings, and the nested messages.
+constexpr size_t leading_sequence_count = 17u;
+
+}  // namespace
+
+TEST(TestSerializationPlan, primitives) {
+  check_round_trip(get_messages_basic_types());
+  check_round_trip(get_messages_defaults());
+}
+
+TEST(TestSerializationPlan, arrays_and_sequences) {
+  check_round_trip(get_messages_arrays());
+  check_round_trip(get_messages_bounded_sequences());
+  check_round_trip(get_messages_unbounded_sequences());
+}
+
+TEST(TestSerializationPlan, strings) {
+  check_round_trip(get_messages_strings());
+  check_round_trip(get_messages_wstrings());
+}
+
+TEST(TestSerializationPlan, nested) {
+  check_round_trip(get_messages_nested());
+  check_round_trip(get_messages_multi_nested());
+}
+
+TEST(TestSerializationPlan, blocks_match_fields) {
+  check_blocks_match_fields(get_messages_basic_types());
+  check_blocks_match_fields(get_messages_arrays());
+  check_blocks_match_fields(get_messages_bounded_sequences());
+  check_blocks_match_fields(get_messages_strings());
+  check_blocks_match_fields(get_messages_nested());
+  check_blocks_match_fields(get_messages_multi_nested());
+}
+
+// Messages are only loaned as they are in memory when that is their CDR layout.
+TEST(TestSerializationPlan, plain_types_have_their_cdr_layout) {
+  // Nested messages of 32 bits integers only
+  EXPECT_TRUE(is_plain<test_msgs::msg::Builtins>());
+  // Booleans, padding between the fields, and at the end of the message
+  EXPECT_FALSE(is_plain<test_msgs::msg::BasicTypes>());
+  EXPECT_FALSE(is_plain<test_msgs::msg::Nested>());
+  EXPECT_FALSE(is_plain<test_msgs::msg::Empty>());
+  // Strings and sequences
+  EXPECT_FALSE(is_plain<test_msgs::msg::Strings>());
+  EXPECT_FALSE(is_plain<test_msgs::msg::BoundedSequences>());
+}
+
+// The lengths read from the wire are checked against the payload before making room for the
+// elements, so that a malformed sample is rejected instead of allocating gigabytes.
+TEST(TestSerializationPlan, oversized_sequence_lengths_are_rejected) {
+  const rosidl_message_type_support_t * cpp_ts =
+    rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::UnboundedSequences>();
+  const rosidl_message_type_support_t * c_ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  std::vector<char> buffer;
+
+  for (size_t field = 0; field < leading_sequence_count; ++field) {
+    SCOPED_TRACE("field " + std::to_string(field));
+    rmw_serialized_message_t serialized_message = make_oversized_sequence(field, buffer);
+
+    test_msgs::msg::UnboundedSequences cpp_message;
+    EXPECT_NE(RMW_RET_OK, rmw_deserialize(&serialized_message, cpp_ts, &cpp_message));
+    rmw_reset_error();
+
+    test_msgs__msg__UnboundedSequences c_message;
+    ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&c_message));
+    EXPECT_NE(RMW_RET_OK, rmw_deserialize(&serialized_message, c_ts, &c_message));
+    rmw_reset_error();
+    test_msgs__msg__UnboundedSequences__fini(&c_message);
+  }
+}
+
+// Taking into the same message reuses its sequence of wide strings when it is large enough.
+TEST(TestSerializationPlan, wstring_sequences_are_reused) {
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, WStrings);
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  ASSERT_EQ(RMW_RET_OK, rmw_serialized_message_init(&serialized_message, 0u, &allocator));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&serialized_message));
+  });
+  test_msgs__msg__WStrings input;
+  ASSERT_TRUE(test_msgs__msg__WStrings__init(&input));
+  test_msgs__msg__WStrings output;
+  ASSERT_TRUE(test_msgs__msg__WStrings__init(&output));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__WStrings__fini(&output);
+    test_msgs__msg__WStrings__fini(&input);
+  });
+
+  const uint16_t values[][3] = {{'a', 'b', 0}, {'c', 0, 0}, {'d', 'e', 0}};
+  auto & input_sequence = input.unbounded_sequence_of_wstrings;
+  auto & output_sequence = output.unbounded_sequence_of_wstrings;
+  ASSERT_TRUE(rosidl_runtime_c__U16String__Sequence__init(&input_sequence, 3u));
+  for (size_t i = 0; i < 3u; ++i) {
+    ASSERT_TRUE(rosidl_runtime_c__U16String__assign(&input_sequence.data[i], values[i]));
+  }
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&input, ts, &serialized_message)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&serialized_message, ts, &output)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(3u, output_sequence.size);
+  rosidl_runtime_c__U16String * data = output_sequence.data;
+
+  // Fewer strings fit in the sequence already there
+  input_sequence.size = 1u;
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&input, ts, &serialized_message)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&serialized_message, ts, &output)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(data, output_sequence.data);
+  ASSERT_EQ(1u, output_sequence.size);
+  EXPECT_LE(3u, output_sequence.capacity);
+  EXPECT_EQ(2u, output_sequence.data[0].size);
+  EXPECT_EQ('a', output_sequence.data[0].data[0]);
+  EXPECT_EQ('b', output_sequence.data[0].data[1]);
+}
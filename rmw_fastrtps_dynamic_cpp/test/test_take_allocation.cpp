@@ -0,0 +1,255 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "osrf_testing_tools_cpp/memory_tools/memory_tools.hpp"
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+
+#include "test_msgs/msg/strings.h"
+#include "test_msgs/msg/unbounded_sequences.h"
+
+class TestTakeAllocation : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    ret = rmw_init(&options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    node = rmw_create_node(&context, "my_node", "/my_ns");
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+
+    osrf_testing_tools_cpp::memory_tools::initialize();
+    osrf_testing_tools_cpp::memory_tools::on_unexpected_malloc(
+      []() {ADD_FAILURE() << "unexpected malloc";});
+    osrf_testing_tools_cpp::memory_tools::on_unexpected_realloc(
+      []() {ADD_FAILURE() << "unexpected realloc";});
+    osrf_testing_tools_cpp::memory_tools::on_unexpected_calloc(
+      []() {ADD_FAILURE() << "unexpected calloc";});
+    osrf_testing_tools_cpp::memory_tools::on_unexpected_free(
+      []() {ADD_FAILURE() << "unexpected free";});
+  }
+
+  void TearDown() override
+  {
+    osrf_testing_tools_cpp::memory_tools::uninitialize();
+
+    rmw_ret_t ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  // Wait until the subscription has data, without taking it.
+  void wait_for_data(rmw_subscription_t * sub)
+  {
+    rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1);
+    ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+    });
+    void * subscriptions_storage[1] = {sub->data};
+    rmw_subscriptions_t subscriptions = {1, subscriptions_storage};
+    rmw_time_t timeout = {5, 0};
+    rmw_ret_t ret = rmw_wait(&subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set, &timeout);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+};
+
+static void
+fill(test_msgs__msg__Strings * msg)
+{
+  const std::string value(256, 'a');
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg->string_value, value.c_str()));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg->bounded_string_value, "bounded"));
+}
+
+static void
+fill(test_msgs__msg__UnboundedSequences * msg)
+{
+  const std::string value(64, 'b');
+  ASSERT_TRUE(rosidl_runtime_c__int32__Sequence__init(&msg->int32_values, 1000));
+  ASSERT_TRUE(rosidl_runtime_c__String__Sequence__init(&msg->string_values, 10));
+  for (size_t i = 0; i < msg->string_values.size; ++i) {
+    ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg->string_values.data[i], value.c_str()));
+  }
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__Sequence__init(&msg->basic_types_values, 3));
+}
+
+TEST_F(TestTakeAllocation, take_does_not_allocate) {
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  constexpr char topic_name[] = "/test_take_allocation";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 1;
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rmw_get_error_string().str;
+  });
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+
+  rmw_subscription_allocation_t allocation;
+  rmw_ret_t ret = rmw_init_subscription_allocation(ts, nullptr, &allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_fini_subscription_allocation(&allocation)) <<
+      rmw_get_error_string().str;
+  });
+
+  test_msgs__msg__Strings sent;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&sent));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({test_msgs__msg__Strings__fini(&sent);});
+  fill(&sent);
+  test_msgs__msg__Strings received;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&received));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({test_msgs__msg__Strings__fini(&received);});
+
+  // The first take makes room in the message for the strings.
+  for (size_t i = 0; i < 3; ++i) {
+    ret = rmw_publish(pub, &sent, nullptr);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    wait_for_data(sub);
+
+    bool taken = false;
+    rmw_message_info_t message_info = rmw_get_zero_initialized_message_info();
+    if (0u == i) {
+      ret = rmw_take_with_info(sub, &received, &taken, &message_info, &allocation);
+    } else {
+      osrf_testing_tools_cpp::memory_tools::enable_monitoring();
+      EXPECT_NO_MEMORY_OPERATIONS(
+      {
+        ret = rmw_take_with_info(sub, &received, &taken, &message_info, &allocation);
+      });
+      osrf_testing_tools_cpp::memory_tools::disable_monitoring();
+    }
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_TRUE(taken);
+    EXPECT_STREQ(sent.string_value.data, received.string_value.data);
+    EXPECT_STREQ(sent.bounded_string_value.data, received.bounded_string_value.data);
+  }
+}
+
+TEST_F(TestTakeAllocation, take_sequence_does_not_allocate) {
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  constexpr char topic_name[] = "/test_take_sequence_allocation";
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 1;
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rmw_get_error_string().str;
+  });
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &qos_profile, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  });
+
+  rmw_subscription_allocation_t allocation;
+  rmw_ret_t ret = rmw_init_subscription_allocation(ts, nullptr, &allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_fini_subscription_allocation(&allocation)) <<
+      rmw_get_error_string().str;
+  });
+
+  test_msgs__msg__UnboundedSequences sent;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&sent));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({test_msgs__msg__UnboundedSequences__fini(&sent);});
+  fill(&sent);
+  test_msgs__msg__UnboundedSequences received;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&received));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({test_msgs__msg__UnboundedSequences__fini(&received);});
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_message_sequence_t messages = rmw_get_zero_initialized_message_sequence();
+  ret = rmw_message_sequence_init(&messages, 1u, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({rmw_message_sequence_fini(&messages);});
+  messages.data[0] = &received;
+  rmw_message_info_sequence_t message_infos = rmw_get_zero_initialized_message_info_sequence();
+  ret = rmw_message_info_sequence_init(&message_infos, 1u, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({rmw_message_info_sequence_fini(&message_infos);});
+
+  // The first take makes room in the allocation and in the message.
+  for (size_t i = 0; i < 3; ++i) {
+    ret = rmw_publish(pub, &sent, nullptr);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    wait_for_data(sub);
+
+    size_t taken = 0u;
+    if (0u == i) {
+      ret = rmw_take_sequence(sub, 1u, &messages, &message_infos, &taken, &allocation);
+    } else {
+      osrf_testing_tools_cpp::memory_tools::enable_monitoring();
+      EXPECT_NO_MEMORY_OPERATIONS(
+      {
+        ret = rmw_take_sequence(sub, 1u, &messages, &message_infos, &taken, &allocation);
+      });
+      osrf_testing_tools_cpp::memory_tools::disable_monitoring();
+    }
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_EQ(1u, taken);
+    ASSERT_EQ(sent.int32_values.size, received.int32_values.size);
+    ASSERT_EQ(sent.string_values.size, received.string_values.size);
+    EXPECT_STREQ(sent.string_values.data[0].data, received.string_values.data[0].data);
+    EXPECT_EQ(sent.basic_types_values.size, received.basic_types_values.size);
+  }
+}
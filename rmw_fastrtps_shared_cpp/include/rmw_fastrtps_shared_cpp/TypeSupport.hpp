@@ -35,10 +35,24 @@
 namespace rmw_fastrtps_shared_cpp
 {
 
+enum SerializedDataType
+{
+  // A Cdr when serializing, a FastBuffer when deserializing
+  FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER,
+  // A plain ros message
+  FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE,
+  // A rmw_serialized_message_t, written as is when serializing, and grown as needed when
+  // deserializing
+  FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE,
+  // A rmw_message_sequence_t when deserializing, whose size is the number of messages already
+  // filled, each sample going into the next one
+  FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE_SEQUENCE
+};
+
 // Publishers write method will receive a pointer to this struct
 struct SerializedData
 {
-  bool is_cdr_buffer;  // Whether next field is a pointer to a Cdr or to a plain ros message
+  SerializedDataType type;  // The type of the next field
   void * data;
   const void * impl;   // RMW implementation specific data
 };
@@ -0,0 +1,221 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_SHARED_CPP__COMPRESSION_HPP_
+#define RMW_FASTRTPS_SHARED_CPP__COMPRESSION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "fastdds/dds/publisher/qos/DataWriterQos.hpp"
+#include "fastdds/dds/subscriber/qos/DataReaderQos.hpp"
+#include "fastdds/rtps/common/Guid.h"
+
+#include "rcpputils/thread_safety_annotations.hpp"
+
+#include "rmw_fastrtps_shared_cpp/visibility_control.h"
+
+namespace rmw_fastrtps_shared_cpp
+{
+
+/// Compression of the serialized payloads of a publisher.
+/**
+ * A compressed payload starts with the encapsulation of the message, with
+ * `compressed_encapsulation_flag` set in its first option byte, followed by a zstd frame of the
+ * rest of the message.
+ * Only readers which advertise that they can decompress payloads, in their user data, are sent
+ * compressed payloads: a publisher writes all its messages uncompressed as long as one of its
+ * matched subscriptions does not.
+ */
+struct CompressionSettings
+{
+  /// Serialized messages of at least this size are compressed, 0 if none is.
+  size_t threshold{0};
+  /// zstd compression level.
+  int level{1};
+};
+
+/// Bit of the first encapsulation option byte set on compressed payloads.
+constexpr uint8_t compressed_encapsulation_flag = 0x80;
+
+/// Check whether this library was built with payload compression support.
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+is_compression_available();
+
+/// Check whether a serialized message is a compressed payload.
+inline bool
+is_compressed(const uint8_t * data, size_t length)
+{
+  return length > 4u && (data[2] & compressed_encapsulation_flag) != 0;
+}
+
+/// Compress a serialized message.
+/**
+ * \param[in] data serialized message, starting with its encapsulation
+ * \param[in] length size of the serialized message
+ * \param[in] level zstd compression level
+ * \param[inout] buffer buffer for the compressed payload, grown when needed, so that reusing it
+ *   does not allocate once it fits the largest message
+ * \param[out] compressed_length size of the compressed payload
+ * \return `true` if the message was compressed to a smaller size, `false` otherwise
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+compress_payload(
+  const uint8_t * data,
+  size_t length,
+  int level,
+  std::vector<uint8_t> & buffer,
+  size_t & compressed_length);
+
+/// Default of get_max_decompressed_size().
+constexpr size_t default_max_decompressed_size = 64u * 1024u * 1024u;
+
+/// Get the maximum size of the messages of unbounded types which are decompressed.
+/**
+ * It is taken from environment variable `RMW_FASTRTPS_MAX_DECOMPRESSED_SIZE` the first time it is
+ * called, and is default_max_decompressed_size when the variable is not set or is not valid.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+size_t
+get_max_decompressed_size();
+
+/// Get the size of the serialized message a compressed payload decompresses to.
+/**
+ * The size is read from the zstd frame, so it is checked against the maximum size the message
+ * can have before any buffer is allocated for it.
+ *
+ * \param[in] data compressed payload
+ * \param[in] length size of the compressed payload
+ * \param[in] max_decompressed_length maximum size of the serialized message
+ * \param[out] decompressed_length size of the serialized message
+ * \return `false` if the payload is not valid, or decompresses to more than
+ *   `max_decompressed_length` bytes
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+get_decompressed_size(
+  const uint8_t * data,
+  size_t length,
+  size_t max_decompressed_length,
+  size_t & decompressed_length);
+
+/// Decompress a compressed payload.
+/**
+ * \param[in] data compressed payload
+ * \param[in] length size of the compressed payload
+ * \param[out] out buffer of `decompressed_length` bytes for the serialized message
+ * \param[in] decompressed_length as given by get_decompressed_size()
+ * \return `false` if the payload is not valid
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+decompress_payload(
+  const uint8_t * data,
+  size_t length,
+  uint8_t * out,
+  size_t decompressed_length);
+
+/// Get the compression settings of a DataWriter.
+/**
+ * They are taken from the `rmw_fastrtps.compression`, `rmw_fastrtps.compression.threshold` and
+ * `rmw_fastrtps.compression.level` properties of the DataWriter, which can be set in its XML
+ * profile, and the given default threshold otherwise.
+ * Compression is disabled for DataWriters which use data-sharing, or which are not volatile,
+ * as late-joining readers could not decompress their history.
+ *
+ * \param[in] writer_qos QoS of the DataWriter
+ * \param[in] default_threshold threshold used when the profile does not set one, 0 for none
+ * \param[in] topic_name name of the topic, for logging
+ * \return the compression settings of the DataWriter
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+CompressionSettings
+get_compression_settings(
+  const eprosima::fastdds::dds::DataWriterQos & writer_qos,
+  size_t default_threshold,
+  const char * topic_name);
+
+/// Advertise in the user data of a DataReader that it can decompress payloads.
+/**
+ * Nothing is done when compression is not available, or when the user data was already set,
+ * e.g. by an XML profile.
+ *
+ * \return `true` if the DataReader advertises it can decompress payloads
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+advertise_decompression(eprosima::fastdds::dds::DataReaderQos & reader_qos);
+
+/// Remove the advertisement of advertise_decompression() from the user data of a DataReader.
+/**
+ * Content filters are evaluated on the payloads as they are sent, so a DataReader with a content
+ * filter must not be sent compressed payloads.
+ * The other key/value pairs of the user data are kept.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+void
+withdraw_decompression(eprosima::fastdds::dds::DataReaderQos & reader_qos);
+
+/// Check whether the user data of a DataReader advertises it can decompress payloads.
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+advertises_decompression(const std::vector<uint8_t> & user_data);
+
+/// Set of the DataReaders known to be able to decompress payloads.
+class DecompressingReaders
+{
+public:
+  void
+  add(const eprosima::fastrtps::rtps::GUID_t & guid)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    readers_.insert(guid);
+  }
+
+  void
+  remove(const eprosima::fastrtps::rtps::GUID_t & guid)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    readers_.erase(guid);
+  }
+
+  /// Check whether all the given DataReaders, and at least one, can decompress payloads.
+  bool
+  contain_all(const std::set<eprosima::fastrtps::rtps::GUID_t> & guids) const
+  {
+    if (guids.empty()) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & guid : guids) {
+      if (readers_.count(guid) == 0u) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::set<eprosima::fastrtps::rtps::GUID_t> readers_ RCPPUTILS_TSA_GUARDED_BY(mutex_);
+};
+
+}  // namespace rmw_fastrtps_shared_cpp
+
+#endif  // RMW_FASTRTPS_SHARED_CPP__COMPRESSION_HPP_
@@ -45,6 +45,7 @@
 #include "rmw/event_callback_type.h"
 
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
 
 class ClientListener;
 class ClientPubListener;
@@ -83,7 +84,7 @@ class ClientListener : public eprosima::fastdds::dds::DataReaderListener
 public:
   explicit ClientListener(CustomClientInfo * info)
   : info_(info), list_has_data_(false),
-    conditionMutex_(nullptr), conditionVariable_(nullptr) {}
+    wait_set_attachment_(std::make_shared<rmw_fastrtps_shared_cpp::WaitSetAttachment>()) {}
 
 
   void
@@ -96,9 +97,9 @@ public:
     response.buffer_.reset(new eprosima::fastcdr::FastBuffer());
 
     rmw_fastrtps_shared_cpp::SerializedData data;
-    data.is_cdr_buffer = true;
+    data.type = rmw_fastrtps_shared_cpp::FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER;
     data.data = response.buffer_.get();
-    data.impl = nullptr;    // not used when is_cdr_buffer is true
+    data.impl = nullptr;    // not used when type is FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER
     while (reader->take_next_sample(&data, &response.sample_info_) == ReturnCode_t::RETCODE_OK) {
       if (response.sample_info_.valid_data) {
         response.sample_identity_ = response.sample_info_.related_sample_identity;
@@ -114,19 +115,9 @@ public:
             }
           }
 
-          if (conditionMutex_ != nullptr) {
-            std::unique_lock<std::mutex> clock(*conditionMutex_);
-            list.emplace_back(std::move(response));
-            // the change to list_has_data_ needs to be mutually exclusive with
-            // rmw_wait() which checks hasData() and decides if wait() needs to
-            // be called
-            list_has_data_.store(true);
-            clock.unlock();
-            conditionVariable_->notify_one();
-          } else {
-            list.emplace_back(std::move(response));
-            list_has_data_.store(true);
-          }
+          list.emplace_back(std::move(response));
+          bool had_data = list_has_data_.exchange(true);
+          wait_set_attachment_->notify_if_became_ready(!had_data);
 
           std::unique_lock<std::mutex> lock_mutex(on_new_response_m_);
 
@@ -144,28 +135,14 @@ public:
   getResponse(CustomClientResponse & response)
   {
     std::lock_guard<std::mutex> lock(internalMutex_);
-
-    if (conditionMutex_ != nullptr) {
-      std::unique_lock<std::mutex> clock(*conditionMutex_);
-      return popResponse(response);
-    }
     return popResponse(response);
   }
 
-  void
-  attachCondition(std::mutex * conditionMutex, std::condition_variable * conditionVariable)
+  /// Get the link to the wait sets this listener is attached to.
+  const std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> &
+  wait_set_attachment() const
   {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = conditionMutex;
-    conditionVariable_ = conditionVariable;
-  }
-
-  void
-  detachCondition()
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = nullptr;
-    conditionVariable_ = nullptr;
+    return wait_set_attachment_;
   }
 
   bool
@@ -230,8 +207,7 @@ private:
   std::mutex internalMutex_;
   std::list<CustomClientResponse> list RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
   std::atomic_bool list_has_data_;
-  std::mutex * conditionMutex_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-  std::condition_variable * conditionVariable_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
+  std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> wait_set_attachment_;
   std::set<eprosima::fastrtps::rtps::GUID_t> publishers_;
 
   rmw_event_callback_t on_new_response_cb_{nullptr};
@@ -28,21 +28,18 @@
 #include "rmw/event_callback_type.h"
 
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
 
 
 class EventListenerInterface
 {
-protected:
-  class ConditionalScopedLock;
-
 public:
-  /// Connect a condition variable so a waiter can be notified of new data.
-  virtual void attachCondition(
-    std::mutex * conditionMutex,
-    std::condition_variable * conditionVariable) = 0;
-
-  /// Unset the information from attachCondition.
-  virtual void detachCondition() = 0;
+  /// Get the link to the wait sets this listener is attached to.
+  const std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> &
+  wait_set_attachment() const
+  {
+    return wait_set_attachment_;
+  }
 
   /// Check if there is new data available for a specific event type.
   /**
@@ -70,34 +67,10 @@ public:
   const void * user_data_{nullptr};
   uint64_t unread_events_count_ = 0;
   std::mutex on_new_event_m_;
-};
 
-class EventListenerInterface::ConditionalScopedLock
-{
-public:
-  ConditionalScopedLock(
-    std::mutex * mutex,
-    std::condition_variable * condition_variable = nullptr)
-  : mutex_(mutex), cv_(condition_variable)
-  {
-    if (nullptr != mutex_) {
-      mutex_->lock();
-    }
-  }
-
-  ~ConditionalScopedLock()
-  {
-    if (nullptr != mutex_) {
-      mutex_->unlock();
-      if (nullptr != cv_) {
-        cv_->notify_all();
-      }
-    }
-  }
-
-private:
-  std::mutex * mutex_;
-  std::condition_variable * cv_;
+protected:
+  const std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> wait_set_attachment_ =
+    std::make_shared<rmw_fastrtps_shared_cpp::WaitSetAttachment>();
 };
 
 struct CustomEventInfo
@@ -15,9 +15,12 @@
 #ifndef RMW_FASTRTPS_SHARED_CPP__CUSTOM_PARTICIPANT_INFO_HPP_
 #define RMW_FASTRTPS_SHARED_CPP__CUSTOM_PARTICIPANT_INFO_HPP_
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "fastdds/dds/domain/DomainParticipant.hpp"
@@ -38,6 +41,7 @@
 
 #include "rmw_dds_common/context.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/create_rmw_gid.hpp"
 #include "rmw_fastrtps_shared_cpp/qos.hpp"
 #include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
@@ -53,6 +57,13 @@ enum class publishing_mode_t
   AUTO           // Use publishing mode set in XML file or Fast DDS default
 };
 
+enum class data_sharing_mode_t
+{
+  OFF,               // Data-sharing delivery is never used
+  AUTO,              // Data-sharing delivery is used for plain types whose QoS allow it
+  INTRA_PARTICIPANT  // Data-sharing delivery is used between the endpoints of the participant
+};
+
 typedef struct CustomParticipantInfo
 {
   eprosima::fastdds::dds::DomainParticipant * participant_{nullptr};
@@ -71,6 +82,18 @@ typedef struct CustomParticipantInfo
   // with the default configuration.
   bool leave_middleware_default_qos;
   publishing_mode_t publishing_mode;
+  data_sharing_mode_t data_sharing_mode;
+  // Data-sharing domains given to the DataWriters and DataReaders which use data-sharing,
+  // empty to use the default domain of the host.
+  std::vector<uint16_t> data_sharing_domain_ids;
+  // Whether messages of unbounded types are serialized in a single pass, into a buffer which
+  // is then copied into the payload, instead of computing their size beforehand.
+  bool single_pass_serialization;
+  // Serialized messages of at least this size are compressed, unless the XML profile of their
+  // DataWriter says otherwise; 0 if they are not compressed by default.
+  size_t compression_threshold;
+  // DataReaders, local or discovered, which can decompress messages.
+  std::shared_ptr<rmw_fastrtps_shared_cpp::DecompressingReaders> decompressing_readers_;
 } CustomParticipantInfo;
 
 class ParticipantListener : public eprosima::fastdds::dds::DomainParticipantListener
@@ -78,9 +101,11 @@ class ParticipantListener : public eprosima::fastdds::dds::DomainParticipantList
 public:
   explicit ParticipantListener(
     const char * identifier,
-    rmw_dds_common::Context * context)
+    rmw_dds_common::Context * context,
+    std::shared_ptr<rmw_fastrtps_shared_cpp::DecompressingReaders> decompressing_readers)
   : context(context),
-    identifier_(identifier)
+    identifier_(identifier),
+    decompressing_readers_(std::move(decompressing_readers))
   {}
 
   void on_participant_discovery(
@@ -121,6 +146,20 @@ public:
     eprosima::fastdds::dds::DomainParticipant *,
     eprosima::fastrtps::rtps::ReaderDiscoveryInfo && info) override
   {
+    if (decompressing_readers_) {
+      // The user data of a reader can change, so it is looked at on every update
+      if (eprosima::fastrtps::rtps::ReaderDiscoveryInfo::DISCOVERED_READER == info.status ||
+        eprosima::fastrtps::rtps::ReaderDiscoveryInfo::CHANGED_QOS_READER == info.status)
+      {
+        if (rmw_fastrtps_shared_cpp::advertises_decompression(info.info.m_qos.m_userData)) {
+          decompressing_readers_->add(info.info.guid());
+        } else {
+          decompressing_readers_->remove(info.info.guid());
+        }
+      } else {
+        decompressing_readers_->remove(info.info.guid());
+      }
+    }
     if (eprosima::fastrtps::rtps::ReaderDiscoveryInfo::CHANGED_QOS_READER != info.status) {
       bool is_alive =
         eprosima::fastrtps::rtps::ReaderDiscoveryInfo::DISCOVERED_READER == info.status;
@@ -172,6 +211,7 @@ private:
 
   rmw_dds_common::Context * context;
   const char * const identifier_;
+  std::shared_ptr<rmw_fastrtps_shared_cpp::DecompressingReaders> decompressing_readers_;
 };
 
 #endif  // RMW_FASTRTPS_SHARED_CPP__CUSTOM_PARTICIPANT_INFO_HPP_
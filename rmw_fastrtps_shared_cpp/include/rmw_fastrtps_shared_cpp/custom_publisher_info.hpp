@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <set>
 
@@ -34,6 +35,7 @@
 #include "rcpputils/thread_safety_annotations.hpp"
 #include "rmw/rmw.h"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_event_info.hpp"
 
 
@@ -49,6 +51,12 @@ typedef struct CustomPublisherInfo : public CustomEventInfo
   const void * type_support_impl_{nullptr};
   rmw_gid_t publisher_gid{};
   const char * typesupport_identifier_{nullptr};
+  // Whether messages are serialized before being written, so that their size does not need to
+  // be computed beforehand.
+  bool serialize_in_single_pass_{false};
+  // Compression of the messages, and the readers of the participant known to decompress them.
+  rmw_fastrtps_shared_cpp::CompressionSettings compression_;
+  std::shared_ptr<rmw_fastrtps_shared_cpp::DecompressingReaders> decompressing_readers_;
 
   RMW_FASTRTPS_SHARED_CPP_PUBLIC
   EventListenerInterface *
@@ -61,9 +69,7 @@ public:
   explicit PubListener(CustomPublisherInfo * info)
   : deadline_changes_(false),
     liveliness_changes_(false),
-    incompatible_qos_changes_(false),
-    conditionMutex_(nullptr),
-    conditionVariable_(nullptr)
+    incompatible_qos_changes_(false)
   {
     (void) info;
   }
@@ -122,20 +128,12 @@ public:
     return subscriptions_.size();
   }
 
-  void
-  attachCondition(std::mutex * conditionMutex, std::condition_variable * conditionVariable)
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = conditionMutex;
-    conditionVariable_ = conditionVariable;
-  }
-
-  void
-  detachCondition()
+  // Whether there are matched subscriptions and all of them can decompress messages
+  bool
+  subscriptionsDecompress(const rmw_fastrtps_shared_cpp::DecompressingReaders & readers) const
   {
     std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = nullptr;
-    conditionVariable_ = nullptr;
+    return readers.contain_all(subscriptions_);
   }
 
 private:
@@ -155,9 +153,6 @@ private:
   std::atomic_bool incompatible_qos_changes_;
   eprosima::fastdds::dds::OfferedIncompatibleQosStatus incompatible_qos_status_
   RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-
-  std::mutex * conditionMutex_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-  std::condition_variable * conditionVariable_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
 };
 
 #endif  // RMW_FASTRTPS_SHARED_CPP__CUSTOM_PUBLISHER_INFO_HPP_
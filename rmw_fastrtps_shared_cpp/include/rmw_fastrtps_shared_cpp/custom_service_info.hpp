@@ -44,6 +44,7 @@
 
 #include "rmw_fastrtps_shared_cpp/guid_utils.hpp"
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
 
 class ServiceListener;
 class ServicePubListener;
@@ -185,7 +186,7 @@ class ServiceListener : public eprosima::fastdds::dds::DataReaderListener
 public:
   explicit ServiceListener(CustomServiceInfo * info)
   : info_(info), list_has_data_(false),
-    conditionMutex_(nullptr), conditionVariable_(nullptr)
+    wait_set_attachment_(std::make_shared<rmw_fastrtps_shared_cpp::WaitSetAttachment>())
   {
   }
 
@@ -209,9 +210,9 @@ public:
     request.buffer_ = new eprosima::fastcdr::FastBuffer();
 
     rmw_fastrtps_shared_cpp::SerializedData data;
-    data.is_cdr_buffer = true;
+    data.type = rmw_fastrtps_shared_cpp::FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER;
     data.data = request.buffer_;
-    data.impl = nullptr;    // not used when is_cdr_buffer is true
+    data.impl = nullptr;    // not used when type is FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER
     while (reader->take_next_sample(&data, &request.sample_info_) == ReturnCode_t::RETCODE_OK) {
       if (request.sample_info_.valid_data) {
         request.sample_identity_ = request.sample_info_.sample_identity;
@@ -235,19 +236,9 @@ public:
           }
         }
 
-        if (conditionMutex_ != nullptr) {
-          std::unique_lock<std::mutex> clock(*conditionMutex_);
-          list.push_back(request);
-          // the change to list_has_data_ needs to be mutually exclusive with
-          // rmw_wait() which checks hasData() and decides if wait() needs to
-          // be called
-          list_has_data_.store(true);
-          clock.unlock();
-          conditionVariable_->notify_one();
-        } else {
-          list.push_back(request);
-          list_has_data_.store(true);
-        }
+        list.push_back(request);
+        bool had_data = list_has_data_.exchange(true);
+        wait_set_attachment_->notify_if_became_ready(!had_data);
 
         std::unique_lock<std::mutex> lock_mutex(on_new_request_m_);
 
@@ -266,38 +257,20 @@ public:
     std::lock_guard<std::mutex> lock(internalMutex_);
     CustomServiceRequest request;
 
-    if (conditionMutex_ != nullptr) {
-      std::unique_lock<std::mutex> clock(*conditionMutex_);
-      if (!list.empty()) {
-        request = list.front();
-        list.pop_front();
-        list_has_data_.store(!list.empty());
-      }
-    } else {
-      if (!list.empty()) {
-        request = list.front();
-        list.pop_front();
-        list_has_data_.store(!list.empty());
-      }
+    if (!list.empty()) {
+      request = list.front();
+      list.pop_front();
+      list_has_data_.store(!list.empty());
     }
 
     return request;
   }
 
-  void
-  attachCondition(std::mutex * conditionMutex, std::condition_variable * conditionVariable)
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = conditionMutex;
-    conditionVariable_ = conditionVariable;
-  }
-
-  void
-  detachCondition()
+  /// Get the link to the wait sets this listener is attached to.
+  const std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> &
+  wait_set_attachment() const
   {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = nullptr;
-    conditionVariable_ = nullptr;
+    return wait_set_attachment_;
   }
 
   bool
@@ -334,8 +307,7 @@ private:
   std::mutex internalMutex_;
   std::list<CustomServiceRequest> list RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
   std::atomic_bool list_has_data_;
-  std::mutex * conditionMutex_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-  std::condition_variable * conditionVariable_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
+  std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> wait_set_attachment_;
 
   rmw_event_callback_t on_new_request_cb_{nullptr};
   const void * user_data_{nullptr};
@@ -44,6 +44,7 @@
 
 #include "rmw_dds_common/context.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_event_info.hpp"
 
 
@@ -65,6 +66,9 @@ struct CustomSubscriberInfo : public CustomEventInfo
   rmw_gid_t subscription_gid_{};
   const char * typesupport_identifier_{nullptr};
   std::shared_ptr<rmw_fastrtps_shared_cpp::LoanManager> loan_manager_;
+  bool can_loan_serialized_messages_{false};
+  // Readers of the participant which can decompress messages, set if this one can.
+  std::shared_ptr<rmw_fastrtps_shared_cpp::DecompressingReaders> decompressing_readers_;
 
   // for re-create or delete content filtered topic
   const rmw_node_t * node_ {nullptr};
@@ -89,9 +93,7 @@ public:
     deadline_changes_(false),
     liveliness_changes_(false),
     sample_lost_changes_(false),
-    incompatible_qos_changes_(false),
-    conditionMutex_(nullptr),
-    conditionVariable_(nullptr)
+    incompatible_qos_changes_(false)
   {
     qos_depth_ = (qos_depth > 0) ? qos_depth : std::numeric_limits<size_t>::max();
     // Field is not used right now
@@ -168,22 +170,6 @@ public:
   takeNextEvent(rmw_event_type_t event_type, void * event_info) final;
 
   // SubListener API
-  void
-  attachCondition(std::mutex * conditionMutex, std::condition_variable * conditionVariable)
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = conditionMutex;
-    conditionVariable_ = conditionVariable;
-  }
-
-  void
-  detachCondition()
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = nullptr;
-    conditionVariable_ = nullptr;
-  }
-
   bool
   hasData() const
   {
@@ -196,11 +182,15 @@ public:
     // Make sure to call into Fast DDS before taking the lock to avoid an
     // ABBA deadlock between internalMutex_ and mutexes inside of Fast DDS.
     auto unread_count = reader->get_unread_count();
-    bool has_data = unread_count > 0;
+    update_has_data(unread_count > 0);
+  }
 
+  void
+  update_has_data(bool has_data)
+  {
     std::lock_guard<std::mutex> lock(internalMutex_);
-    ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-    data_.store(has_data, std::memory_order_relaxed);
+    bool had_data = data_.exchange(has_data, std::memory_order_relaxed);
+    wait_set_attachment_->notify_if_became_ready(has_data && !had_data);
   }
 
   size_t publisherCount()
@@ -254,9 +244,6 @@ private:
   eprosima::fastdds::dds::RequestedIncompatibleQosStatus incompatible_qos_status_
   RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
 
-  std::mutex * conditionMutex_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-  std::condition_variable * conditionVariable_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-
   std::set<eprosima::fastrtps::rtps::GUID_t> publishers_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
 
   rmw_event_callback_t on_new_message_cb_{nullptr};
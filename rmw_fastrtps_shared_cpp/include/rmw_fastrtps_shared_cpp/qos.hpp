@@ -16,9 +16,13 @@
 #ifndef RMW_FASTRTPS_SHARED_CPP__QOS_HPP_
 #define RMW_FASTRTPS_SHARED_CPP__QOS_HPP_
 
+#include <cstdint>
+#include <vector>
+
 #include <fastdds/dds/core/policy/QosPolicies.hpp>
 #include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
 #include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+#include <fastdds/dds/topic/TypeSupport.hpp>
 #include <fastdds/dds/topic/qos/TopicQos.hpp>
 
 #include "fastrtps/qos/QosPolicies.h"
@@ -49,6 +53,51 @@ get_topic_qos(
   const rmw_qos_profile_t & qos_policies,
   eprosima::fastdds::dds::TopicQos & topic_qos);
 
+/// Enable data-sharing delivery on an endpoint, if its type and QoS allow it.
+/**
+ * Data-sharing lets endpoints on the same host exchange samples through a pool of shared memory
+ * owned by the writer, instead of copying them through a transport into every reader.
+ * It can only be used with bounded types and a KEEP_LAST history, as the pool has a fixed size.
+ * Samples of plain types are stored as is, so they can also be loaned without serializing them.
+ * The automatic kind is used, so Fast DDS still uses the transports to reach endpoints which
+ * are on other hosts or do not share a data-sharing domain with this one.
+ * Data-sharing is turned off when it cannot be used.
+ *
+ * \param[in] type type of the endpoint
+ * \param[in] topic_name name of the topic, for logging
+ * \param[in] plain_only whether types which are not plain should not use data-sharing
+ * \param[in] domain_ids data-sharing domains of the endpoint, empty for the default one,
+ *   which is shared by all the endpoints of the host
+ * \param[inout] dds_qos of type DataWriterQos or DataReaderQos, with its history already set
+ * \return `true` if data-sharing was enabled, `false` otherwise
+ */
+template<typename DDSEntityQos>
+bool
+enable_data_sharing_if_supported(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  DDSEntityQos & dds_qos);
+
+extern template RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+enable_data_sharing_if_supported<eprosima::fastdds::dds::DataWriterQos>(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  eprosima::fastdds::dds::DataWriterQos & dds_qos);
+
+extern template RMW_FASTRTPS_SHARED_CPP_PUBLIC
+bool
+enable_data_sharing_if_supported<eprosima::fastdds::dds::DataReaderQos>(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  eprosima::fastdds::dds::DataReaderQos & dds_qos);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_time_t
 dds_duration_to_rmw(const eprosima::fastrtps::Duration_t & duration);
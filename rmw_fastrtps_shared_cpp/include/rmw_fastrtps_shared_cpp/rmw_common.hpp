@@ -129,6 +129,36 @@ __rmw_get_node_names_with_enclaves(
   rcutils_string_array_t * node_namespaces,
   rcutils_string_array_t * enclaves);
 
+/// Initialize an allocation to be used when publishing.
+/**
+ * Publications do not need storage of their own: messages are serialized straight into the
+ * payloads of the history of the writer, which are reserved when the publisher is created and
+ * reused afterwards.
+ * For bounded types they are reserved with the maximum serialized size of the type, and for
+ * unbounded types they grow to the largest message published and keep that size, so once the
+ * publisher has been warmed up, publishing does not allocate.
+ *
+ * \param[in] identifier The implementation identifier of the rmw implementation.
+ * \param[in] type_support Type support of the messages to be published.
+ * \param[in] message_bounds Bounds of the messages, unused.
+ * \param[out] allocation Allocation to be initialized.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` or `allocation` is NULL.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_init_publisher_allocation(
+  const char * identifier,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t * allocation);
+
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_fini_publisher_allocation(
+  const char * identifier,
+  rmw_publisher_allocation_t * allocation);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_publish(
@@ -137,6 +167,40 @@ __rmw_publish(
   const void * ros_message,
   rmw_publisher_allocation_t * allocation);
 
+/// Publish several messages at once.
+/**
+ * The messages are published in order, as if __rmw_publish() was called for each of them, but
+ * the publisher is only checked and looked up once.
+ * With the asynchronous publishing mode, the messages are queued back to back to the flow
+ * controller of the writer, which groups the ones queued since it last ran into the same
+ * datagrams.
+ *
+ * All the messages are checked before any of them is published.
+ * If publishing one of them fails, the ones before it have been published, and the others are
+ * not.
+ *
+ * \param[in] identifier The implementation identifier of the rmw implementation.
+ * \param[in] publisher Publisher to publish the messages with.
+ * \param[in] ros_messages Array of `count` messages to publish.
+ * \param[in] count Number of messages to publish.
+ * \param[out] published Number of messages published.
+ * \param[in] allocation Publisher allocation, may be NULL.
+ * \return `RMW_RET_OK` if all the messages were published, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `publisher`, `published` or any message is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the publisher or the allocation are from
+ *   another implementation, or
+ * \return `RMW_RET_ERROR` if a message could not be published.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_publish_many(
+  const char * identifier,
+  const rmw_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_publish_serialized_message(
@@ -356,6 +420,35 @@ __rmw_client_response_subscription_get_actual_qos(
   const rmw_client_t * client,
   rmw_qos_profile_t * qos);
 
+/// Initialize the storage reused by the takes done with a subscription allocation.
+/**
+ * Messages are deserialized in place into the ones given to take, reusing their strings and
+ * sequences when they are large enough, so once the allocation and the messages have been used
+ * with the largest samples expected, taking from the subscription does not allocate anymore.
+ *
+ * \param[in] identifier The implementation identifier of the rmw implementation.
+ * \param[in] type_support Type support of the messages to be taken.
+ * \param[in] message_bounds Bounds of the messages, unused.
+ * \param[out] allocation Allocation to be initialized.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` or `allocation` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return `RMW_RET_ERROR` if an unexpected error occurs.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_init_subscription_allocation(
+  const char * identifier,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t * allocation);
+
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_fini_subscription_allocation(
+  const char * identifier,
+  rmw_subscription_allocation_t * allocation);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_take(
@@ -392,6 +485,37 @@ __rmw_return_loaned_message_from_subscription(
   const rmw_subscription_t * subscription,
   void * loaned_message);
 
+/// Take the serialized form of a sample, loaned from the subscription.
+/**
+ * Only supported for subscriptions to types which are not plain, whose messages cannot be
+ * loaned with __rmw_take_loaned_message_internal().
+ * The reader keeps the samples of those types serialized: the CDR payload is copied once into
+ * the loaned sample, decompressed if it was compressed, and is handed out without deserializing it.
+ * The loan must be returned with __rmw_return_loaned_serialized_message_from_subscription(),
+ * and the serialized message must not be modified in the meantime.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the subscription is from another
+ *   implementation, or
+ * \return `RMW_RET_UNSUPPORTED` if the type of the subscription is plain.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_take_loaned_serialized_message(
+  const char * identifier,
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info);
+
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_return_loaned_serialized_message_from_subscription(
+  const char * identifier,
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * loaned_message);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_take_event(
@@ -458,6 +582,88 @@ RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_destroy_wait_set(const char * identifier, rmw_wait_set_t * wait_set);
 
+/// Get a file descriptor which is readable when entities of a wait set may be ready.
+/**
+ * The entities are the ones given to the last call to rmw_wait() on the wait set, which stay
+ * attached to it until the next call.
+ * The descriptor can then be polled (e.g. with epoll) along with other file descriptors, and
+ * rmw_wait() be called with a zero timeout once it is readable, which makes it unreadable again
+ * unless some entity is still ready afterwards.
+ *
+ * The descriptor is created on first call and owned by the wait set, it must not be closed.
+ * This function must not be called concurrently with rmw_wait() on the same wait set.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `wait_set` or `fd` is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation, or
+ * \return `RMW_RET_UNSUPPORTED` if not on Linux, or
+ * \return `RMW_RET_ERROR` if the descriptor could not be created.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_wait_set_get_fd(const char * identifier, rmw_wait_set_t * wait_set, int * fd);
+
+/// Set for how long rmw_wait() busy-polls a wait set before blocking.
+/**
+ * When nothing is ready, rmw_wait() first polls for up to this period (or until its timeout, if
+ * shorter), backing off with pause instructions and then yields, before blocking on a condition
+ * variable.
+ * This trades CPU time for wake-up latency.
+ * Wait sets are created with the period given by the `RMW_FASTRTPS_WAIT_SPIN_US` environment
+ * variable, which must be shorter than two seconds, or zero (never poll) if it is not set.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `wait_set` or `spin_period` is NULL, or if the period
+ *   is two seconds or more, or if its nanoseconds make a second or more, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_wait_set_set_spin_period(
+  const char * identifier,
+  rmw_wait_set_t * wait_set,
+  const rmw_time_t * spin_period);
+
+/// Get how many rmw_wait() calls on a wait set found ready entities by polling or by blocking.
+/**
+ * Only calls which found nothing ready at first and had to wait are counted.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_wait_set_get_wakeup_counts(
+  const char * identifier,
+  const rmw_wait_set_t * wait_set,
+  uint64_t * spin_wakeups,
+  uint64_t * block_wakeups);
+
+/// Get how many notifications the entities of a wait set skipped.
+/**
+ * Entities only notify the wait sets they are attached to when they become ready; any other
+ * change of their state (e.g. new data while data was already available, or data being taken)
+ * is counted as a suppressed notification.
+ * The count covers the state changes of the entities while they were attached to this wait set,
+ * i.e. from the call to rmw_wait() they were given to until a later call no longer waits on
+ * them, since the wait set was created.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if any argument is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the wait set is from another
+ *   implementation.
+ */
+RMW_FASTRTPS_SHARED_CPP_PUBLIC
+rmw_ret_t
+__rmw_wait_set_get_suppressed_notification_count(
+  const char * identifier,
+  const rmw_wait_set_t * wait_set,
+  uint64_t * count);
+
 RMW_FASTRTPS_SHARED_CPP_PUBLIC
 rmw_ret_t
 __rmw_get_publishers_info_by_topic(
@@ -0,0 +1,414 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_FASTRTPS_SHARED_CPP__WAIT_SET_ATTACHMENT_HPP_
+#define RMW_FASTRTPS_SHARED_CPP__WAIT_SET_ATTACHMENT_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "rcpputils/thread_safety_annotations.hpp"
+
+#include "rmw_fastrtps_shared_cpp/visibility_control.h"
+
+namespace rmw_fastrtps_shared_cpp
+{
+
+/// Lock-free queue of the entities of a wait set which may have become ready.
+/**
+ * Entities push their node when their state changes, and rmw_wait() takes all of them at once,
+ * so that it only needs to look at the entities which were notified.
+ * Any number of threads may push, but only one may take and wait at a time.
+ *
+ * The waiter is only woken up when the queue stops being empty.
+ * Pushing never blocks: on Linux, the waiter sleeps on a futex which is only woken up (with a
+ * system call) when somebody is actually sleeping on it.
+ * An eventfd can also be set to be signalled at that moment, so that the readiness of the wait
+ * set can be polled along with other file descriptors.
+ */
+class WaitSetReadyQueue
+{
+public:
+  struct Node
+  {
+    /// Queue this node is pushed to.
+    WaitSetReadyQueue * queue{nullptr};
+    /// Positions of the entity in the arrays given to rmw_wait (several for a listener whose
+    /// data and events are both waited on).
+    std::vector<size_t> entries;
+    Node * next{nullptr};
+    std::atomic_bool queued{false};
+    /// Only used by the consumer.
+    bool listed{false};
+  };
+
+  WaitSetReadyQueue()
+  : head_(nullptr), event_fd_(-1), wake_count_(0), sleeping_(0), suppressed_notifications_(0) {}
+
+  /// Push a node, unless it is already in the queue.
+  void
+  push(Node * node)
+  {
+    // Orders the state change of the entity before the check of `queued`, pairs with the fence
+    // in release().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (node->queued.exchange(true, std::memory_order_relaxed)) {
+      return;
+    }
+    Node * head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next = head;
+    } while (!head_.compare_exchange_weak(
+      head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+    if (nullptr == head) {
+      signal();
+      wake();
+    }
+  }
+
+  /// Take all the queued nodes, most recent first.
+  Node *
+  take_all()
+  {
+    return head_.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  /// Allow a taken node to be pushed again.
+  /**
+   * The state of the entity must be checked after calling this, so that changes done before
+   * the node could be pushed again are not missed.
+   */
+  static void
+  release(Node * node)
+  {
+    node->queued.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  bool
+  empty() const
+  {
+    return head_.load(std::memory_order_acquire) == nullptr;
+  }
+
+  /// Block until the queue is not empty.
+  void
+  wait()
+  {
+    wait_for_push(nullptr);
+  }
+
+  /// Block until the queue is not empty or the deadline is reached.
+  /**
+   * \return `false` if the deadline was reached with the queue still empty.
+   */
+  bool
+  wait_until(const std::chrono::steady_clock::time_point & deadline)
+  {
+    return wait_for_push(&deadline);
+  }
+
+  /// Get the eventfd signalled by this queue, -1 if none.
+  int
+  event_fd() const
+  {
+    return event_fd_.load(std::memory_order_seq_cst);
+  }
+
+  /// Set the eventfd to signal, and signal it if the queue is not empty.
+  void
+  set_event_fd(int event_fd)
+  {
+    event_fd_.store(event_fd, std::memory_order_seq_cst);
+    if (head_.load(std::memory_order_seq_cst) != nullptr) {
+      signal();
+    }
+  }
+
+  /// Make the eventfd readable.
+  void
+  signal()
+  {
+#ifdef __linux__
+    int event_fd = event_fd_.load(std::memory_order_seq_cst);
+    if (event_fd >= 0) {
+      eventfd_write(event_fd, 1);
+    }
+#endif
+  }
+
+  /// Make the eventfd not readable.
+  /**
+   * This must be done before taking the nodes, so that a push done afterwards signals it again.
+   */
+  void
+  clear_signal()
+  {
+#ifdef __linux__
+    int event_fd = event_fd_.load(std::memory_order_relaxed);
+    if (event_fd >= 0) {
+      eventfd_t value;
+      eventfd_read(event_fd, &value);
+    }
+#endif
+  }
+
+  /// Count a state change of an attached entity which did not need to be notified.
+  void
+  count_suppressed_notification()
+  {
+    suppressed_notifications_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Get how many state changes of the attached entities did not need to be notified.
+  uint64_t
+  suppressed_notifications() const
+  {
+    return suppressed_notifications_.load(std::memory_order_relaxed);
+  }
+
+private:
+  /// Wake the waiter up, if it is blocked.
+  RMW_FASTRTPS_SHARED_CPP_PUBLIC
+  void
+  wake();
+
+  RMW_FASTRTPS_SHARED_CPP_PUBLIC
+  bool
+  wait_for_push(const std::chrono::steady_clock::time_point * deadline);
+
+  std::atomic<Node *> head_;
+  std::atomic_int event_fd_;
+  /// Incremented on every wake-up, the futex word the waiter sleeps on.
+  std::atomic<uint32_t> wake_count_;
+  std::atomic<uint32_t> sleeping_;
+  std::atomic<uint64_t> suppressed_notifications_;
+#ifndef __linux__
+  std::mutex mutex_;
+  std::condition_variable condition_;
+#endif
+};
+
+/// Registry of the wait sets a listener is attached to.
+/**
+ * Ownership of this object is shared between the listener and the wait sets it has been
+ * attached to.
+ * This allows wait sets to keep listeners attached between calls to rmw_wait, and to detach
+ * them later on even if the listener has been destroyed in the meantime.
+ *
+ * An entity can be attached to any number of wait sets at the same time, e.g. by the threads of
+ * a multi-threaded executor.
+ * Notifying them does not take any lock: attaching and detaching are serialized, and detaching
+ * waits for the notifications in progress to finish before the wait set can drop its node.
+ * Slots are allocated by blocks of `slots_per_block`, which are only freed along with this
+ * object, so that notifiers can go through them while more are added.
+ */
+class WaitSetAttachment
+{
+public:
+  static constexpr size_t slots_per_block = 8;
+
+  WaitSetAttachment()
+  : active_notifiers_(0)
+  {
+  }
+
+  ~WaitSetAttachment()
+  {
+    SlotBlock * block = first_block_.next.load(std::memory_order_relaxed);
+    while (nullptr != block) {
+      SlotBlock * next = block->next.load(std::memory_order_relaxed);
+      delete block;
+      block = next;
+    }
+  }
+
+  WaitSetAttachment(const WaitSetAttachment &) = delete;
+  WaitSetAttachment & operator=(const WaitSetAttachment &) = delete;
+
+  /// Attach to a wait set, which will be notified through the given node of its ready queue.
+  void
+  attach(WaitSetReadyQueue::Node * node)
+  {
+    std::lock_guard<std::mutex> lock(internalMutex_);
+    SlotBlock * free_block = nullptr;
+    size_t free_slot = 0;
+    SlotBlock * last_block = nullptr;
+    for (SlotBlock * block = &first_block_; nullptr != block;
+      block = block->next.load(std::memory_order_relaxed))
+    {
+      for (size_t i = 0; i < slots_per_block; ++i) {
+        const WaitSetReadyQueue * owner = block->owners[i].load(std::memory_order_relaxed);
+        if (owner == node->queue) {
+          clear_slot(*block, i);
+          set_slot(*block, i, node);
+          return;
+        }
+        if (nullptr == owner && nullptr == free_block) {
+          free_block = block;
+          free_slot = i;
+        }
+      }
+      last_block = block;
+    }
+    if (nullptr == free_block) {
+      // Every slot is used, notifiers see the new block once it is linked.
+      free_block = new SlotBlock();
+      free_slot = 0;
+      last_block->next.store(free_block, std::memory_order_release);
+    }
+    set_slot(*free_block, free_slot, node);
+  }
+
+  /// Detach from a wait set, if still attached to it.
+  /**
+   * Once this returns, the node given when attaching will not be pushed anymore.
+   */
+  void
+  detach(const WaitSetReadyQueue * queue)
+  {
+    std::lock_guard<std::mutex> lock(internalMutex_);
+    for (SlotBlock * block = &first_block_; nullptr != block;
+      block = block->next.load(std::memory_order_relaxed))
+    {
+      for (size_t i = 0; i < slots_per_block; ++i) {
+        if (block->owners[i].load(std::memory_order_relaxed) == queue) {
+          clear_slot(*block, i);
+        }
+      }
+    }
+  }
+
+  /// Check, without locking, whether this is attached to a wait set.
+  bool
+  is_attached_to(const WaitSetReadyQueue * queue) const
+  {
+    for (const SlotBlock * block = &first_block_; nullptr != block;
+      block = block->next.load(std::memory_order_acquire))
+    {
+      for (size_t i = 0; i < slots_per_block; ++i) {
+        if (block->owners[i].load(std::memory_order_acquire) == queue) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /// Notify all the attached wait sets that the state of the listener changed.
+  /**
+   * This must be called after the change, so that waiters either see it when checking the
+   * entities, or are notified.
+   */
+  void
+  notify()
+  {
+    for_each_attached_node(
+      [](WaitSetReadyQueue::Node * node) {
+        node->queue->push(node);
+      });
+  }
+
+  /// Notify all the attached wait sets if the listener just became ready.
+  /**
+   * Wait sets keep checking the entities which were found ready until they are not anymore,
+   * so only the transition to ready needs to be notified; other state changes are only counted
+   * by each of the attached wait sets.
+   */
+  void
+  notify_if_became_ready(bool became_ready)
+  {
+    if (became_ready) {
+      notify();
+    } else {
+      for_each_attached_node(
+        [](WaitSetReadyQueue::Node * node) {
+          node->queue->count_suppressed_notification();
+        });
+    }
+  }
+
+private:
+  struct SlotBlock
+  {
+    SlotBlock()
+    : next(nullptr)
+    {
+      for (size_t i = 0; i < slots_per_block; ++i) {
+        nodes[i].store(nullptr, std::memory_order_relaxed);
+        owners[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::atomic<WaitSetReadyQueue::Node *> nodes[slots_per_block];
+    std::atomic<const WaitSetReadyQueue *> owners[slots_per_block];
+    std::atomic<SlotBlock *> next;
+  };
+
+  /// Call `f` with the node of each attached wait set, which stays valid during the call.
+  template<typename FunctorT>
+  void
+  for_each_attached_node(FunctorT f)
+  {
+    active_notifiers_.fetch_add(1, std::memory_order_seq_cst);
+    for (SlotBlock * block = &first_block_; nullptr != block;
+      block = block->next.load(std::memory_order_acquire))
+    {
+      for (size_t i = 0; i < slots_per_block; ++i) {
+        WaitSetReadyQueue::Node * node = block->nodes[i].load(std::memory_order_seq_cst);
+        if (nullptr != node) {
+          f(node);
+        }
+      }
+    }
+    active_notifiers_.fetch_sub(1, std::memory_order_release);
+  }
+
+  void
+  set_slot(SlotBlock & block, size_t slot, WaitSetReadyQueue::Node * node)
+  RCPPUTILS_TSA_REQUIRES(internalMutex_)
+  {
+    block.nodes[slot].store(node, std::memory_order_seq_cst);
+    block.owners[slot].store(node->queue, std::memory_order_release);
+  }
+
+  void
+  clear_slot(SlotBlock & block, size_t slot) RCPPUTILS_TSA_REQUIRES(internalMutex_)
+  {
+    block.nodes[slot].store(nullptr, std::memory_order_seq_cst);
+    block.owners[slot].store(nullptr, std::memory_order_release);
+    // Notifiers which did not see the slot cleared have already registered themselves.
+    while (active_notifiers_.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::mutex internalMutex_;
+  SlotBlock first_block_;
+  std::atomic_size_t active_notifiers_;
+};
+
+}  // namespace rmw_fastrtps_shared_cpp
+
+#endif  // RMW_FASTRTPS_SHARED_CPP__WAIT_SET_ATTACHMENT_HPP_
@@ -30,8 +30,11 @@
 #include "fastrtps/types/TypeNamesGenerator.h"
 #include "fastrtps/types/AnnotationParameterValue.h"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
 #include "rmw/error_handling.h"
+#include "rmw/message_sequence.h"
+#include "rmw/serialized_message.h"
 
 #include "rosidl_typesupport_introspection_c/identifier.h"
 #include "rosidl_typesupport_introspection_cpp/identifier.hpp"
@@ -51,15 +54,36 @@ TypeSupport::TypeSupport()
   auto_fill_type_information(false);
 }
 
+// Samples created by readers, to loan samples of non-plain types, keep them serialized.
 void TypeSupport::deleteData(void * data)
 {
   assert(data);
-  delete static_cast<eprosima::fastcdr::FastBuffer *>(data);
+  auto ser_data = static_cast<SerializedData *>(data);
+  auto serialized_message = static_cast<rmw_serialized_message_t *>(ser_data->data);
+  if (rmw_serialized_message_fini(serialized_message) != RMW_RET_OK) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "failed to finalize serialized message: %s", rmw_get_error_string().str);
+    rmw_reset_error();
+  }
+  delete serialized_message;
+  delete ser_data;
 }
 
 void * TypeSupport::createData()
 {
-  return new eprosima::fastcdr::FastBuffer();
+  auto serialized_message = new rmw_serialized_message_t;
+  *serialized_message = rmw_get_zero_initialized_serialized_message();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  if (rmw_serialized_message_init(serialized_message, 0u, &allocator) != RMW_RET_OK) {
+    delete serialized_message;
+    return nullptr;
+  }
+  auto ser_data = new SerializedData;
+  ser_data->type = FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE;
+  ser_data->data = serialized_message;
+  ser_data->impl = nullptr;
+  return ser_data;
 }
 
 bool TypeSupport::serialize(
@@ -69,7 +93,7 @@ bool TypeSupport::serialize(
   assert(payload);
 
   auto ser_data = static_cast<SerializedData *>(data);
-  if (ser_data->is_cdr_buffer) {
+  if (FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER == ser_data->type) {
     auto ser = static_cast<eprosima::fastcdr::Cdr *>(ser_data->data);
     if (payload->max_size >= ser->getSerializedDataLength()) {
       payload->length = static_cast<uint32_t>(ser->getSerializedDataLength());
@@ -78,6 +102,18 @@ bool TypeSupport::serialize(
       memcpy(payload->data, ser->getBufferPointer(), ser->getSerializedDataLength());
       return true;
     }
+  } else if (FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE == ser_data->type) {
+    // The message already starts with its encapsulation, so this is the only copy it needs.
+    auto serialized_message = static_cast<const rmw_serialized_message_t *>(ser_data->data);
+    if (payload->max_size >= serialized_message->buffer_length) {
+      payload->length = static_cast<uint32_t>(serialized_message->buffer_length);
+      // The second byte of the encapsulation tells the endianness of the message
+      payload->encapsulation =
+        (serialized_message->buffer_length > 1 && (serialized_message->buffer[1] & 0x01) == 0) ?
+        CDR_BE : CDR_LE;
+      memcpy(payload->data, serialized_message->buffer, serialized_message->buffer_length);
+      return true;
+    }
   } else {
     eprosima::fastcdr::FastBuffer fastbuffer(
       reinterpret_cast<char *>(payload->data),
@@ -102,24 +138,95 @@ bool TypeSupport::deserialize(
   assert(data);
   assert(payload);
 
+  // Compressed payloads are decompressed first, so that callers always get the serialized message
+  // that was published.
+  // Their size is read from the payload, so it is checked against the size the message can have
+  // before allocating anything for it.
+  const bool compressed = is_compressed(payload->data, payload->length);
+  size_t length = payload->length;
+  if (compressed) {
+    size_t max_length = max_size_bound_ ? m_typeSize : get_max_decompressed_size();
+    if (!get_decompressed_size(payload->data, payload->length, max_length, length)) {
+      RMW_SET_ERROR_MSG(
+        is_compression_available() ?
+        "received an invalid or too large compressed payload" :
+        "received a compressed payload, but this library was built without zstd");
+      return false;
+    }
+  }
+
   auto ser_data = static_cast<SerializedData *>(data);
-  if (ser_data->is_cdr_buffer) {
+  if (FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER == ser_data->type) {
     auto buffer = static_cast<eprosima::fastcdr::FastBuffer *>(ser_data->data);
-    if (!buffer->reserve(payload->length)) {
+    if (!buffer->reserve(length)) {
       return false;
     }
+    if (compressed) {
+      return decompress_payload(
+        payload->data, payload->length, reinterpret_cast<uint8_t *>(buffer->getBuffer()), length);
+    }
     memcpy(buffer->getBuffer(), payload->data, payload->length);
     return true;
   }
 
-  eprosima::fastcdr::FastBuffer fastbuffer(
-    reinterpret_cast<char *>(payload->data),
-    payload->length);
+  if (FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE == ser_data->type) {
+    // Copy the payload straight into the caller's buffer, growing it in place when needed.
+    auto serialized_message = static_cast<rmw_serialized_message_t *>(ser_data->data);
+    if (serialized_message->buffer_capacity < length) {
+      if (rmw_serialized_message_resize(serialized_message, length) != RMW_RET_OK) {
+        return false;  // Error message already set
+      }
+    }
+    if (compressed) {
+      if (!decompress_payload(
+          payload->data, payload->length, serialized_message->buffer, length))
+      {
+        RMW_SET_ERROR_MSG("failed to decompress payload");
+        return false;
+      }
+    } else {
+      memcpy(serialized_message->buffer, payload->data, payload->length);
+    }
+    serialized_message->buffer_length = length;
+    return true;
+  }
+
+  void * ros_message = ser_data->data;
+  rmw_message_sequence_t * message_sequence = nullptr;
+  if (FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE_SEQUENCE == ser_data->type) {
+    message_sequence = static_cast<rmw_message_sequence_t *>(ser_data->data);
+    if (message_sequence->size >= message_sequence->capacity) {
+      RMW_SET_ERROR_MSG("no message left in the sequence to deserialize into");
+      return false;
+    }
+    ros_message = message_sequence->data[message_sequence->size];
+  }
+
+  char * buffer = reinterpret_cast<char *>(payload->data);
+  if (compressed) {
+    // Only grows up to the largest message this thread has received, which is bounded above.
+    thread_local std::vector<uint8_t> decompressed;
+    if (decompressed.size() < length) {
+      decompressed.resize(length);
+    }
+    if (!decompress_payload(payload->data, payload->length, decompressed.data(), length)) {
+      RMW_SET_ERROR_MSG("failed to decompress payload");
+      return false;
+    }
+    buffer = reinterpret_cast<char *>(decompressed.data());
+  }
+  eprosima::fastcdr::FastBuffer fastbuffer(buffer, length);
   eprosima::fastcdr::Cdr deser(
     fastbuffer,
     eprosima::fastcdr::Cdr::DEFAULT_ENDIAN,
     eprosima::fastcdr::Cdr::DDS_CDR);
-  return deserializeROSmessage(deser, ser_data->data, ser_data->impl);
+  if (!deserializeROSmessage(deser, ros_message, ser_data->impl)) {
+    return false;
+  }
+  if (nullptr != message_sequence) {
+    ++message_sequence->size;
+  }
+  return true;
 }
 
 std::function<uint32_t()> TypeSupport::getSerializedSizeProvider(void * data)
@@ -129,10 +236,19 @@ std::function<uint32_t()> TypeSupport::getSerializedSizeProvider(void * data)
   auto ser_data = static_cast<SerializedData *>(data);
   auto ser_size = [this, ser_data]() -> uint32_t
     {
-      if (ser_data->is_cdr_buffer) {
+      if (FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER == ser_data->type) {
         auto ser = static_cast<eprosima::fastcdr::Cdr *>(ser_data->data);
         return static_cast<uint32_t>(ser->getSerializedDataLength());
       }
+      if (FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE == ser_data->type) {
+        auto serialized_message = static_cast<const rmw_serialized_message_t *>(ser_data->data);
+        return static_cast<uint32_t>(serialized_message->buffer_length);
+      }
+      // Bounded messages never go over the size payloads are preallocated with, so there is no
+      // need to walk them to compute their actual size.
+      if (max_size_bound_) {
+        return m_typeSize;
+      }
       return static_cast<uint32_t>(
         this->getEstimatedSerializedSize(
           ser_data->data,
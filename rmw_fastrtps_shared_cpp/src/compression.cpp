@@ -0,0 +1,362 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "fastdds/dds/core/policy/QosPolicies.hpp"
+#include "fastdds/rtps/attributes/PropertyPolicy.h"
+
+#include "rcutils/env.h"
+#include "rcutils/logging_macros.h"
+
+#include "rmw/impl/cpp/key_value.hpp"
+
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
+
+namespace rmw_fastrtps_shared_cpp
+{
+
+namespace
+{
+
+// Size of the encapsulation, which is kept uncompressed at the start of the payload.
+constexpr size_t encapsulation_size = 4u;
+
+constexpr const char compression_key[] = "compression";
+constexpr const char compression_value[] = "zstd";
+
+#if HAVE_ZSTD
+// Contexts are reused by each thread, as creating them costs more than compressing small messages.
+ZSTD_CCtx *
+get_compression_context()
+{
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> context(
+    ZSTD_createCCtx(), ZSTD_freeCCtx);
+  return context.get();
+}
+
+ZSTD_DCtx *
+get_decompression_context()
+{
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> context(
+    ZSTD_createDCtx(), ZSTD_freeDCtx);
+  return context.get();
+}
+#endif
+
+bool
+parse_size(const std::string & value, size_t & result)
+{
+  const char * begin = value.c_str();
+  char * end = nullptr;
+  errno = 0;
+  unsigned long long parsed = std::strtoull(begin, &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || end == begin || *end != '\0' || value[0] == '-' ||
+    parsed > std::numeric_limits<size_t>::max())
+  {
+    return false;
+  }
+  result = static_cast<size_t>(parsed);
+  return true;
+}
+
+// Parse a compression level, which must be one supported by zstd.
+bool
+parse_level(const std::string & value, int & result)
+{
+  const char * begin = value.c_str();
+  char * end = nullptr;
+  errno = 0;
+  long parsed = std::strtol(begin, &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || end == begin || *end != '\0') {
+    return false;
+  }
+#if HAVE_ZSTD
+  if (parsed < ZSTD_minCLevel() || parsed > ZSTD_maxCLevel()) {
+    return false;
+  }
+#else
+  if (parsed < std::numeric_limits<int>::min() || parsed > std::numeric_limits<int>::max()) {
+    return false;
+  }
+#endif
+  result = static_cast<int>(parsed);
+  return true;
+}
+
+}  // namespace
+
+bool
+is_compression_available()
+{
+#if HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool
+compress_payload(
+  const uint8_t * data,
+  size_t length,
+  int level,
+  std::vector<uint8_t> & buffer,
+  size_t & compressed_length)
+{
+#if HAVE_ZSTD
+  if (length <= encapsulation_size) {
+    return false;
+  }
+  ZSTD_CCtx * context = get_compression_context();
+  if (nullptr == context) {
+    return false;
+  }
+  size_t bound = encapsulation_size + ZSTD_compressBound(length - encapsulation_size);
+  if (buffer.size() < bound) {
+    buffer.resize(bound);
+  }
+  size_t ret = ZSTD_compressCCtx(
+    context, buffer.data() + encapsulation_size, buffer.size() - encapsulation_size,
+    data + encapsulation_size, length - encapsulation_size, level);
+  if (ZSTD_isError(ret) || encapsulation_size + ret >= length) {
+    return false;
+  }
+  memcpy(buffer.data(), data, encapsulation_size);
+  buffer[2] |= compressed_encapsulation_flag;
+  compressed_length = encapsulation_size + ret;
+  return true;
+#else
+  static_cast<void>(data);
+  static_cast<void>(length);
+  static_cast<void>(level);
+  static_cast<void>(buffer);
+  static_cast<void>(compressed_length);
+  return false;
+#endif
+}
+
+size_t
+get_max_decompressed_size()
+{
+  static const size_t max_size = []() {
+      const char * env_value = nullptr;
+      const char * error_str = rcutils_get_env("RMW_FASTRTPS_MAX_DECOMPRESSED_SIZE", &env_value);
+      size_t value = default_max_decompressed_size;
+      if (nullptr == error_str && nullptr != env_value && '\0' != *env_value &&
+        (!parse_size(env_value, value) || value <= encapsulation_size ||
+        value > std::numeric_limits<uint32_t>::max()))
+      {
+        RCUTILS_LOG_WARN_NAMED(
+          "rmw_fastrtps_shared_cpp",
+          "Value %s invalid for environment variable RMW_FASTRTPS_MAX_DECOMPRESSED_SIZE"
+          ". Using %zu instead.", env_value, default_max_decompressed_size);
+        value = default_max_decompressed_size;
+      }
+      return value;
+    }();
+  return max_size;
+}
+
+bool
+get_decompressed_size(
+  const uint8_t * data,
+  size_t length,
+  size_t max_decompressed_length,
+  size_t & decompressed_length)
+{
+#if HAVE_ZSTD
+  if (!is_compressed(data, length) || max_decompressed_length < encapsulation_size) {
+    return false;
+  }
+  unsigned long long content_size = ZSTD_getFrameContentSize(  // NOLINT(runtime/int)
+    data + encapsulation_size, length - encapsulation_size);
+  if (ZSTD_CONTENTSIZE_UNKNOWN == content_size || ZSTD_CONTENTSIZE_ERROR == content_size ||
+    content_size > max_decompressed_length - encapsulation_size)
+  {
+    return false;
+  }
+  decompressed_length = encapsulation_size + static_cast<size_t>(content_size);
+  return true;
+#else
+  static_cast<void>(data);
+  static_cast<void>(length);
+  static_cast<void>(max_decompressed_length);
+  static_cast<void>(decompressed_length);
+  return false;
+#endif
+}
+
+bool
+decompress_payload(
+  const uint8_t * data,
+  size_t length,
+  uint8_t * out,
+  size_t decompressed_length)
+{
+#if HAVE_ZSTD
+  if (!is_compressed(data, length) || decompressed_length < encapsulation_size) {
+    return false;
+  }
+  ZSTD_DCtx * context = get_decompression_context();
+  if (nullptr == context) {
+    return false;
+  }
+  size_t ret = ZSTD_decompressDCtx(
+    context, out + encapsulation_size, decompressed_length - encapsulation_size,
+    data + encapsulation_size, length - encapsulation_size);
+  if (ZSTD_isError(ret) || encapsulation_size + ret != decompressed_length) {
+    return false;
+  }
+  memcpy(out, data, encapsulation_size);
+  out[2] &= static_cast<uint8_t>(~compressed_encapsulation_flag);
+  return true;
+#else
+  static_cast<void>(data);
+  static_cast<void>(length);
+  static_cast<void>(out);
+  static_cast<void>(decompressed_length);
+  return false;
+#endif
+}
+
+CompressionSettings
+get_compression_settings(
+  const eprosima::fastdds::dds::DataWriterQos & writer_qos,
+  size_t default_threshold,
+  const char * topic_name)
+{
+  using eprosima::fastrtps::rtps::PropertyPolicyHelper;
+
+  CompressionSettings settings;
+  settings.threshold = default_threshold;
+
+  const std::string * value =
+    PropertyPolicyHelper::find_property(writer_qos.properties(), "rmw_fastrtps.compression");
+  if (nullptr != value) {
+    if (*value == "none") {
+      return CompressionSettings();
+    } else if (*value != compression_value) {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_fastrtps_shared_cpp",
+        "Value %s unknown for property rmw_fastrtps.compression of topic %s"
+        ". Payloads will not be compressed.", value->c_str(), topic_name);
+      return CompressionSettings();
+    } else if (0u == settings.threshold) {
+      settings.threshold = 1u;
+    }
+  }
+  value = PropertyPolicyHelper::find_property(
+    writer_qos.properties(), "rmw_fastrtps.compression.threshold");
+  if (nullptr != value && !parse_size(*value, settings.threshold)) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Invalid value %s for property rmw_fastrtps.compression.threshold of topic %s"
+      ". Payloads will not be compressed.", value->c_str(), topic_name);
+    return CompressionSettings();
+  }
+  value = PropertyPolicyHelper::find_property(
+    writer_qos.properties(), "rmw_fastrtps.compression.level");
+  if (nullptr != value && !parse_level(*value, settings.level)) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Invalid value %s for property rmw_fastrtps.compression.level of topic %s"
+      ". Using level %d instead.", value->c_str(), topic_name, CompressionSettings().level);
+    settings.level = CompressionSettings().level;
+  }
+
+  if (0u == settings.threshold) {
+    return settings;
+  }
+  if (!is_compression_available()) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Payloads of topic %s will not be compressed, as this library was built without zstd",
+      topic_name);
+    return CompressionSettings();
+  }
+  if (eprosima::fastdds::dds::DataSharingKind::OFF != writer_qos.data_sharing().kind()) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Payloads of topic %s will not be compressed, as it uses data-sharing", topic_name);
+    return CompressionSettings();
+  }
+  if (eprosima::fastdds::dds::VOLATILE_DURABILITY_QOS != writer_qos.durability().kind) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Payloads of topic %s will not be compressed, as it is not volatile", topic_name);
+    return CompressionSettings();
+  }
+  return settings;
+}
+
+bool
+advertise_decompression(eprosima::fastdds::dds::DataReaderQos & reader_qos)
+{
+  if (!is_compression_available()) {
+    return false;
+  }
+  auto & user_data = reader_qos.user_data();
+  if (!user_data.empty()) {
+    return advertises_decompression(user_data.data_vec());
+  }
+  std::string key_value = std::string(compression_key) + "=" + compression_value + ";";
+  user_data.setValue(
+    std::vector<eprosima::fastrtps::rtps::octet>(key_value.begin(), key_value.end()));
+  return true;
+}
+
+void
+withdraw_decompression(eprosima::fastdds::dds::DataReaderQos & reader_qos)
+{
+  auto & user_data = reader_qos.user_data();
+  if (!advertises_decompression(user_data.data_vec())) {
+    return;
+  }
+  std::string key_values;
+  for (const auto & key_value : rmw::impl::cpp::parse_key_value(user_data.data_vec())) {
+    if (key_value.first != compression_key) {
+      key_values += key_value.first + "=" +
+        std::string(key_value.second.begin(), key_value.second.end()) + ";";
+    }
+  }
+  user_data.setValue(
+    std::vector<eprosima::fastrtps::rtps::octet>(key_values.begin(), key_values.end()));
+}
+
+bool
+advertises_decompression(const std::vector<uint8_t> & user_data)
+{
+  if (user_data.empty()) {
+    return false;
+  }
+  auto map = rmw::impl::cpp::parse_key_value(user_data);
+  auto found = map.find(compression_key);
+  if (found == map.end()) {
+    return false;
+  }
+  return std::string(found->second.begin(), found->second.end()) == compression_value;
+}
+
+}  // namespace rmw_fastrtps_shared_cpp
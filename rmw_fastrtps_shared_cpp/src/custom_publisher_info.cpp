@@ -33,16 +33,13 @@ PubListener::on_offered_deadline_missed(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to liveliness_lost_count_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   offered_deadline_missed_status_.total_count = status.total_count;
   // Accumulate deltas
   offered_deadline_missed_status_.total_count_change += status.total_count_change;
 
-  deadline_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !deadline_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 
   std::unique_lock<std::mutex> lock_mutex(on_new_event_m_);
 
@@ -59,16 +56,13 @@ void PubListener::on_liveliness_lost(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to liveliness_lost_count_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   liveliness_lost_status_.total_count = status.total_count;
   // Accumulate deltas
   liveliness_lost_status_.total_count_change += status.total_count_change;
 
-  liveliness_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !liveliness_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 
   std::unique_lock<std::mutex> lock_mutex(on_new_event_m_);
 
@@ -85,17 +79,14 @@ void PubListener::on_offered_incompatible_qos(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to incompatible_qos_status_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   incompatible_qos_status_.last_policy_id = status.last_policy_id;
   incompatible_qos_status_.total_count = status.total_count;
   // Accumulate deltas
   incompatible_qos_status_.total_count_change += status.total_count_change;
 
-  incompatible_qos_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !incompatible_qos_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 }
 
 bool PubListener::hasEvent(rmw_event_type_t event_type) const
@@ -33,16 +33,13 @@ SubListener::on_requested_deadline_missed(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to liveliness_lost_count_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   requested_deadline_missed_status_.total_count = status.total_count;
   // Accumulate deltas
   requested_deadline_missed_status_.total_count_change += status.total_count_change;
 
-  deadline_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !deadline_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 
   std::unique_lock<std::mutex> lock_mutex(on_new_event_m_);
 
@@ -59,10 +56,6 @@ void SubListener::on_liveliness_changed(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to liveliness_lost_count_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   liveliness_changed_status_.alive_count = status.alive_count;
   liveliness_changed_status_.not_alive_count = status.not_alive_count;
@@ -70,7 +63,8 @@ void SubListener::on_liveliness_changed(
   liveliness_changed_status_.alive_count_change += status.alive_count_change;
   liveliness_changed_status_.not_alive_count_change += status.not_alive_count_change;
 
-  liveliness_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !liveliness_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 
   std::unique_lock<std::mutex> lock_mutex(on_new_event_m_);
 
@@ -87,16 +81,13 @@ void SubListener::on_sample_lost(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to sample_lost_status_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   sample_lost_status_.total_count = status.total_count;
   // Accumulate deltas
   sample_lost_status_.total_count_change += status.total_count_change;
 
-  sample_lost_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !sample_lost_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 }
 
 void SubListener::on_requested_incompatible_qos(
@@ -105,17 +96,14 @@ void SubListener::on_requested_incompatible_qos(
 {
   std::lock_guard<std::mutex> lock(internalMutex_);
 
-  // the change to incompatible_qos_status_ needs to be mutually exclusive with
-  // rmw_wait() which checks hasEvent() and decides if wait() needs to be called
-  ConditionalScopedLock clock(conditionMutex_, conditionVariable_);
-
   // Assign absolute values
   incompatible_qos_status_.last_policy_id = status.last_policy_id;
   incompatible_qos_status_.total_count = status.total_count;
   // Accumulate deltas
   incompatible_qos_status_.total_count_change += status.total_count_change;
 
-  incompatible_qos_changes_.store(true, std::memory_order_relaxed);
+  bool changed = !incompatible_qos_changes_.exchange(true, std::memory_order_relaxed);
+  wait_set_attachment_->notify_if_became_ready(changed);
 }
 
 bool SubListener::hasEvent(rmw_event_type_t event_type) const
@@ -13,6 +13,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdlib>
 #include <string>
 #include <memory>
 #include <unordered_map>
@@ -28,6 +29,7 @@
 #include "fastdds/dds/subscriber/Subscriber.hpp"
 #include "fastdds/dds/subscriber/qos/SubscriberQos.hpp"
 #include "fastdds/rtps/attributes/PropertyPolicy.h"
+#include "fastdds/rtps/common/Guid.h"
 #include "fastdds/rtps/common/Property.h"
 #include "fastdds/rtps/transport/UDPv4TransportDescriptor.h"
 #include "fastdds/rtps/transport/shared_mem/SharedMemTransportDescriptor.h"
@@ -53,6 +55,9 @@ __create_participant(
   const eprosima::fastdds::dds::DomainParticipantQos & domainParticipantQos,
   bool leave_middleware_default_qos,
   publishing_mode_t publishing_mode,
+  data_sharing_mode_t data_sharing_mode,
+  bool single_pass_serialization,
+  size_t compression_threshold,
   rmw_dds_common::Context * common_context,
   size_t domain_id)
 {
@@ -81,8 +86,10 @@ __create_participant(
   /////
   // Create Participant listener
   try {
+    participant_info->decompressing_readers_ =
+      std::make_shared<rmw_fastrtps_shared_cpp::DecompressingReaders>();
     participant_info->listener_ = new ParticipantListener(
-      identifier, common_context);
+      identifier, common_context, participant_info->decompressing_readers_);
   } catch (std::bad_alloc &) {
     RMW_SET_ERROR_MSG("__create_participant failed to allocate participant listener");
     return nullptr;
@@ -110,6 +117,21 @@ __create_participant(
   // Set participant info parameters
   participant_info->leave_middleware_default_qos = leave_middleware_default_qos;
   participant_info->publishing_mode = publishing_mode;
+  participant_info->data_sharing_mode = data_sharing_mode;
+  participant_info->single_pass_serialization = single_pass_serialization;
+  participant_info->compression_threshold = compression_threshold;
+  if (data_sharing_mode_t::INTRA_PARTICIPANT == data_sharing_mode) {
+    // Give the endpoints of this participant a data-sharing domain of their own, so that they
+    // only use data-sharing between themselves.
+    // Endpoints of another participant which happens to get the same domain would still use
+    // data-sharing with them, which is harmless.
+    const auto & prefix = participant_info->participant_->guid().guidPrefix;
+    uint16_t domain_id = 0;
+    for (size_t i = 0; i < eprosima::fastrtps::rtps::GuidPrefix_t::size; i += 2) {
+      domain_id ^= static_cast<uint16_t>((prefix.value[i] << 8) | prefix.value[i + 1]);
+    }
+    participant_info->data_sharing_domain_ids.push_back(domain_id);
+  }
 
   /////
   // Create Publisher
@@ -190,6 +212,9 @@ rmw_fastrtps_shared_cpp::create_participant(
 
   bool leave_middleware_default_qos = false;
   publishing_mode_t publishing_mode = publishing_mode_t::SYNCHRONOUS;
+  data_sharing_mode_t data_sharing_mode = data_sharing_mode_t::OFF;
+  bool single_pass_serialization = false;
+  size_t compression_threshold = 0u;
   const char * env_value;
   const char * error_str;
   error_str = rcutils_get_env("RMW_FASTRTPS_USE_QOS_FROM_XML", &env_value);
@@ -220,6 +245,50 @@ rmw_fastrtps_shared_cpp::create_participant(
           ". Using default SYNCHRONOUS publishing mode.", env_value);
       }
     }
+    error_str = rcutils_get_env("RMW_FASTRTPS_DATA_SHARING", &env_value);
+    if (error_str != NULL) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Error getting env var: %s\n", error_str);
+      return nullptr;
+    }
+    if (env_value != nullptr) {
+      if (strcmp(env_value, "OFF") == 0) {
+        data_sharing_mode = data_sharing_mode_t::OFF;
+      } else if (strcmp(env_value, "AUTO") == 0) {
+        data_sharing_mode = data_sharing_mode_t::AUTO;
+      } else if (strcmp(env_value, "INTRA_PARTICIPANT") == 0) {
+        data_sharing_mode = data_sharing_mode_t::INTRA_PARTICIPANT;
+      } else if (strcmp(env_value, "") != 0) {
+        RCUTILS_LOG_WARN_NAMED(
+          "rmw_fastrtps_shared_cpp",
+          "Value %s unknown for environment variable RMW_FASTRTPS_DATA_SHARING"
+          ". Using default OFF data-sharing mode.", env_value);
+      }
+    }
+  }
+  error_str = rcutils_get_env("RMW_FASTRTPS_SINGLE_PASS_SERIALIZATION", &env_value);
+  if (error_str != NULL) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Error getting env var: %s\n", error_str);
+    return nullptr;
+  }
+  if (env_value != nullptr) {
+    single_pass_serialization = strcmp(env_value, "1") == 0;
+  }
+  error_str = rcutils_get_env("RMW_FASTRTPS_COMPRESSION_THRESHOLD", &env_value);
+  if (error_str != NULL) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("Error getting env var: %s\n", error_str);
+    return nullptr;
+  }
+  if (env_value != nullptr && strcmp(env_value, "") != 0) {
+    char * end = nullptr;
+    unsigned long long threshold = strtoull(env_value, &end, 10);  // NOLINT(runtime/int)
+    if (*end != '\0' || env_value[0] == '-') {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_fastrtps_shared_cpp",
+        "Value %s invalid for environment variable RMW_FASTRTPS_COMPRESSION_THRESHOLD"
+        ". Payloads will not be compressed by default.", env_value);
+    } else {
+      compression_threshold = static_cast<size_t>(threshold);
+    }
   }
   // allow reallocation to support discovery messages bigger than 5000 bytes
   if (!leave_middleware_default_qos) {
@@ -286,6 +355,9 @@ rmw_fastrtps_shared_cpp::create_participant(
     domainParticipantQos,
     leave_middleware_default_qos,
     publishing_mode,
+    data_sharing_mode,
+    single_pass_serialization,
+    compression_threshold,
     common_context,
     domain_id);
 }
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <limits>
+#include <vector>
 
 #include "rmw_fastrtps_shared_cpp/qos.hpp"
 
@@ -20,6 +22,8 @@
 #include "fastdds/dds/subscriber/qos/DataReaderQos.hpp"
 #include "fastdds/dds/topic/qos/TopicQos.hpp"
 
+#include "rcutils/logging_macros.h"
+
 #include "rmw/error_handling.h"
 
 #include "time_utils.hpp"
@@ -172,6 +176,63 @@ is_valid_qos(const rmw_qos_profile_t & /* qos_policies */)
   return true;
 }
 
+template<typename DDSEntityQos>
+bool
+enable_data_sharing_if_supported(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  DDSEntityQos & dds_qos)
+{
+  const char * reason = nullptr;
+  if (plain_only && !type->is_plain()) {
+    reason = "its type is not plain";
+  } else if (!type->is_bounded()) {
+    reason = "its type is not bounded";
+  } else if (eprosima::fastdds::dds::KEEP_LAST_HISTORY_QOS != dds_qos.history().kind) {
+    reason = "its history is not KEEP_LAST";
+  }
+
+  if (nullptr != reason) {
+    dds_qos.data_sharing().off();
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Data-sharing not used on topic '%s' because %s", topic_name, reason);
+    return false;
+  }
+
+  dds_qos.data_sharing().automatic(domain_ids);
+  if (type->is_plain()) {
+    RCUTILS_LOG_INFO_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Data-sharing (zero-copy) enabled on topic '%s'", topic_name);
+  } else {
+    RCUTILS_LOG_INFO_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Data-sharing (shared serialized samples) enabled on topic '%s'", topic_name);
+  }
+  return true;
+}
+
+template
+bool
+enable_data_sharing_if_supported<eprosima::fastdds::dds::DataWriterQos>(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  eprosima::fastdds::dds::DataWriterQos & dds_qos);
+
+template
+bool
+enable_data_sharing_if_supported<eprosima::fastdds::dds::DataReaderQos>(
+  const eprosima::fastdds::dds::TypeSupport & type,
+  const char * topic_name,
+  bool plain_only,
+  const std::vector<uint16_t> & domain_ids,
+  eprosima::fastdds::dds::DataReaderQos & dds_qos);
+
 template<typename AttributeT>
 void
 dds_attributes_to_rmw_qos(
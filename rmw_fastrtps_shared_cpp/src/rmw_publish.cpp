@@ -12,14 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include "fastcdr/Cdr.h"
 #include "fastcdr/FastBuffer.h"
+#include "fastcdr/exceptions/Exception.h"
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
+#include "rmw/serialized_message.h"
 #include "rmw/impl/cpp/macros.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_publisher_info.hpp"
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
@@ -28,6 +35,111 @@
 
 namespace rmw_fastrtps_shared_cpp
 {
+// Whether a serialized message of up to that size may be compressed: it is large enough, and all
+// the matched subscriptions can decompress it.
+static bool
+_may_compress(CustomPublisherInfo * info, size_t max_length)
+{
+  return 0u != info->compression_.threshold && max_length >= info->compression_.threshold &&
+         nullptr != info->listener_ &&
+         info->listener_->subscriptionsDecompress(*info->decompressing_readers_);
+}
+
+// Write a serialized message compressed, when it is large enough and all the matched
+// subscriptions can decompress it.
+// `written` is left false, without failing, when the message should be written as is instead.
+static bool
+_write_compressed(
+  CustomPublisherInfo * info, const uint8_t * buffer, size_t length, bool & written)
+{
+  written = false;
+  if (!_may_compress(info, length)) {
+    return true;
+  }
+
+  thread_local std::vector<uint8_t> compressed;
+  size_t compressed_length = 0u;
+  if (!compress_payload(
+      buffer, length, info->compression_.level, compressed, compressed_length))
+  {
+    // Messages which do not get smaller are sent as is
+    return true;
+  }
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  serialized_message.buffer = compressed.data();
+  serialized_message.buffer_length = compressed_length;
+  serialized_message.buffer_capacity = compressed.size();
+
+  rmw_fastrtps_shared_cpp::SerializedData data;
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE;
+  data.data = &serialized_message;
+  data.impl = nullptr;    // not used for serialized messages
+  if (!info->data_writer_->write(&data)) {
+    RMW_SET_ERROR_MSG("cannot publish data");
+    return false;
+  }
+  written = true;
+  return true;
+}
+
+// Write a ROS message, serializing it beforehand when the publisher asks for it, or when it
+// may be compressed.
+static bool
+_write_ros_message(CustomPublisherInfo * info, const void * ros_message)
+{
+  auto type_support = dynamic_cast<rmw_fastrtps_shared_cpp::TypeSupport *>(
+    info->type_support_.get());
+  rmw_fastrtps_shared_cpp::SerializedData data;
+  data.impl = info->type_support_impl_;
+  // Messages which cannot be compressed, as they are too small or as a matched subscription
+  // cannot decompress them, are serialized by the writer straight into its history.
+  const size_t max_length = type_support->is_bounded() ?
+    type_support->m_typeSize : (std::numeric_limits<size_t>::max)();
+  if (!info->serialize_in_single_pass_ && !_may_compress(info, max_length)) {
+    data.type = FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE;
+    data.data = const_cast<void *>(ros_message);
+    if (!info->data_writer_->write(&data)) {
+      RMW_SET_ERROR_MSG("cannot publish data");
+      return false;
+    }
+    return true;
+  }
+
+  // Serializing in a buffer of this thread, which only grows up to the largest message it has
+  // seen, avoids walking the message twice: once to compute its size, and once to serialize it.
+  thread_local eprosima::fastcdr::FastBuffer buffer;
+  eprosima::fastcdr::Cdr ser(
+    buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+  try {
+    if (!type_support->serializeROSmessage(ros_message, ser, info->type_support_impl_)) {
+      RMW_SET_ERROR_MSG("cannot serialize data");
+      return false;
+    }
+  } catch (const eprosima::fastcdr::exception::Exception & ex) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("cannot serialize data: %s", ex.what());
+    return false;
+  }
+
+  bool written = false;
+  if (!_write_compressed(
+      info, reinterpret_cast<const uint8_t *>(ser.getBufferPointer()),
+      ser.getSerializedDataLength(), written))
+  {
+    return false;  // Error message already set
+  }
+  if (written) {
+    return true;
+  }
+
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_CDR_BUFFER;
+  data.data = &ser;
+  if (!info->data_writer_->write(&data)) {
+    RMW_SET_ERROR_MSG("cannot publish data");
+    return false;
+  }
+  return true;
+}
+
 rmw_ret_t
 __rmw_publish(
   const char * identifier,
@@ -39,13 +151,18 @@ __rmw_publish(
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_ERROR);
 
-  (void) allocation;
   RMW_CHECK_FOR_NULL_WITH_MSG(
     publisher, "publisher handle is null",
     return RMW_RET_INVALID_ARGUMENT);
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     publisher, publisher->implementation_identifier, identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      publisher allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
   RMW_CHECK_FOR_NULL_WITH_MSG(
     ros_message, "ros message handle is null",
     return RMW_RET_INVALID_ARGUMENT);
@@ -53,14 +170,62 @@ __rmw_publish(
   auto info = static_cast<CustomPublisherInfo *>(publisher->data);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "publisher info pointer is null", return RMW_RET_ERROR);
 
-  rmw_fastrtps_shared_cpp::SerializedData data;
-  data.is_cdr_buffer = false;
-  data.data = const_cast<void *>(ros_message);
-  data.impl = info->type_support_impl_;
   TRACEPOINT(rmw_publish, ros_message);
-  if (!info->data_writer_->write(&data)) {
-    RMW_SET_ERROR_MSG("cannot publish data");
-    return RMW_RET_ERROR;
+  if (!_write_ros_message(info, ros_message)) {
+    return RMW_RET_ERROR;  // Error message already set
+  }
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+__rmw_publish_many(
+  const char * identifier,
+  const rmw_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation)
+{
+  RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_ERROR);
+
+  RMW_CHECK_ARGUMENT_FOR_NULL(published, RMW_RET_INVALID_ARGUMENT);
+  *published = 0;
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    publisher, "publisher handle is null",
+    return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher, publisher->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      publisher allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
+  if (0u == count) {
+    return RMW_RET_OK;
+  }
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    ros_messages, "ros messages array is null",
+    return RMW_RET_INVALID_ARGUMENT);
+  for (size_t ii = 0; ii < count; ++ii) {
+    RMW_CHECK_FOR_NULL_WITH_MSG(
+      ros_messages[ii], "ros message handle is null",
+      return RMW_RET_INVALID_ARGUMENT);
+  }
+
+  auto info = static_cast<CustomPublisherInfo *>(publisher->data);
+  RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "publisher info pointer is null", return RMW_RET_ERROR);
+
+  for (size_t ii = 0; ii < count; ++ii) {
+    TRACEPOINT(rmw_publish, ros_messages[ii]);
+    if (!_write_ros_message(info, ros_messages[ii])) {
+      return RMW_RET_ERROR;  // Error message already set
+    }
+    ++(*published);
   }
 
   return RMW_RET_OK;
@@ -77,13 +242,18 @@ __rmw_publish_serialized_message(
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_ERROR);
 
-  (void) allocation;
   RMW_CHECK_FOR_NULL_WITH_MSG(
     publisher, "publisher handle is null",
     return RMW_RET_INVALID_ARGUMENT);
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     publisher, publisher->implementation_identifier, identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      publisher allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
   RMW_CHECK_FOR_NULL_WITH_MSG(
     serialized_message, "serialized message handle is null",
     return RMW_RET_INVALID_ARGUMENT);
@@ -91,19 +261,22 @@ __rmw_publish_serialized_message(
   auto info = static_cast<CustomPublisherInfo *>(publisher->data);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "publisher info pointer is null", return RMW_RET_ERROR);
 
-  eprosima::fastcdr::FastBuffer buffer(
-    reinterpret_cast<char *>(serialized_message->buffer), serialized_message->buffer_length);
-  eprosima::fastcdr::Cdr ser(
-    buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
-  if (!ser.jump(serialized_message->buffer_length)) {
-    RMW_SET_ERROR_MSG("cannot correctly set serialized buffer");
-    return RMW_RET_ERROR;
+  bool written = false;
+  if (!_write_compressed(
+      info, serialized_message->buffer, serialized_message->buffer_length, written))
+  {
+    return RMW_RET_ERROR;  // Error message already set
+  }
+  if (written) {
+    return RMW_RET_OK;
   }
 
+  // The serialized message is copied as is into the payload of the history of the writer, it is
+  // not wrapped in a Cdr first.
   rmw_fastrtps_shared_cpp::SerializedData data;
-  data.is_cdr_buffer = true;
-  data.data = &ser;
-  data.impl = nullptr;    // not used when is_cdr_buffer is true
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE;
+  data.data = const_cast<rmw_serialized_message_t *>(serialized_message);
+  data.impl = nullptr;    // not used for serialized messages
   if (!info->data_writer_->write(&data)) {
     RMW_SET_ERROR_MSG("cannot publish data");
     return RMW_RET_ERROR;
@@ -111,6 +284,7 @@ __rmw_publish_serialized_message(
 
   return RMW_RET_OK;
 }
+
 rmw_ret_t
 __rmw_publish_loaned_message(
   const char * identifier,
@@ -118,7 +292,6 @@ __rmw_publish_loaned_message(
   const void * ros_message,
   rmw_publisher_allocation_t * allocation)
 {
-  static_cast<void>(allocation);
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_ERROR);
@@ -127,6 +300,12 @@ __rmw_publish_loaned_message(
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     publisher, publisher->implementation_identifier, identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      publisher allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
   if (!publisher->can_loan_messages) {
     RMW_SET_ERROR_MSG("Loaning is not supported");
     return RMW_RET_UNSUPPORTED;
@@ -36,6 +36,39 @@
 
 namespace rmw_fastrtps_shared_cpp
 {
+rmw_ret_t
+__rmw_init_publisher_allocation(
+  const char * identifier,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  // The payloads messages are serialized into belong to the history of the writer
+  (void) message_bounds;
+
+  allocation->implementation_identifier = identifier;
+  allocation->data = nullptr;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+__rmw_fini_publisher_allocation(
+  const char * identifier,
+  rmw_publisher_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher allocation,
+    allocation->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
+  return RMW_RET_OK;
+}
+
 rmw_ret_t
 __rmw_destroy_publisher(
   const char * identifier,
@@ -18,6 +18,7 @@
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
+#include "rmw/impl/cpp/macros.hpp"
 #include "rmw/rmw.h"
 
 #include "rcpputils/scope_exit.hpp"
@@ -25,6 +26,7 @@
 #include "fastdds/dds/subscriber/DataReader.hpp"
 #include "fastdds/dds/subscriber/qos/DataReaderQos.hpp"
 
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_participant_info.hpp"
 #include "rmw_fastrtps_shared_cpp/custom_subscriber_info.hpp"
 #include "rmw_fastrtps_shared_cpp/namespace_prefix.hpp"
@@ -35,8 +37,65 @@
 #include "rmw_fastrtps_shared_cpp/utils.hpp"
 #include "rmw_fastrtps_shared_cpp/TypeSupport.hpp"
 
+#include "types/custom_subscription_allocation.hpp"
+
 namespace rmw_fastrtps_shared_cpp
 {
+rmw_ret_t
+__rmw_init_subscription_allocation(
+  const char * identifier,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  // Messages are deserialized in place into the ones given to take, so the storage needed here
+  // does not depend on the bounds of the type.
+  (void) message_bounds;
+
+  CustomSubscriptionAllocation * allocation_info = nullptr;
+  void * data = rmw_allocate(sizeof(CustomSubscriptionAllocation));
+  if (!data) {
+    RMW_SET_ERROR_MSG("failed to allocate subscription allocation info");
+    return RMW_RET_BAD_ALLOC;
+  }
+  RMW_TRY_PLACEMENT_NEW(
+    allocation_info,
+    data,
+    rmw_free(data); return RMW_RET_ERROR,
+    // cppcheck-suppress syntaxError
+    CustomSubscriptionAllocation, );
+
+  allocation->implementation_identifier = identifier;
+  allocation->data = allocation_info;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+__rmw_fini_subscription_allocation(
+  const char * identifier,
+  rmw_subscription_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription allocation,
+    allocation->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  rmw_ret_t result = RMW_RET_OK;
+  auto allocation_info = static_cast<CustomSubscriptionAllocation *>(allocation->data);
+  if (allocation_info) {
+    RMW_TRY_DESTRUCTOR(
+      allocation_info->~CustomSubscriptionAllocation(),
+      allocation_info, result = RMW_RET_ERROR)
+    rmw_free(allocation_info);
+  }
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
+  return result;
+}
+
 rmw_ret_t
 __rmw_destroy_subscription(
   const char * identifier,
@@ -169,6 +228,10 @@ __rmw_subscription_set_content_filter(
     }
     info->filtered_topic_ = filtered_topic;
     des_topic = filtered_topic;
+    // Content filters cannot be evaluated on compressed payloads, so the new DataReader does
+    // not advertise it can decompress them, even if the filter is reset later.
+    rmw_fastrtps_shared_cpp::withdraw_decompression(info->datareader_qos_);
+    info->decompressing_readers_.reset();
   } else {
     // use the existing parent topic
     des_topic = info->topic_;
@@ -200,6 +263,10 @@ __rmw_subscription_set_content_filter(
   info->subscription_gid_ = rmw_fastrtps_shared_cpp::create_rmw_gid(
     eprosima_fastrtps_identifier, info->data_reader_->guid());
 
+  if (info->decompressing_readers_) {
+    info->decompressing_readers_->add(info->data_reader_->guid());
+  }
+
   {
     rmw_dds_common::Context * common_context = info->common_context_;
     const rmw_node_t * node = info->node_;
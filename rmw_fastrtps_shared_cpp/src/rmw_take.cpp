@@ -12,8 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
@@ -36,6 +38,9 @@
 
 #include "tracetools/tracetools.h"
 
+#include "types/custom_subscription_allocation.hpp"
+#include "types/loan_pool.hpp"
+
 namespace rmw_fastrtps_shared_cpp
 {
 
@@ -63,6 +68,69 @@ _assign_message_info(
     sender_gid->data);
 }
 
+struct GenericSequence : public eprosima::fastdds::dds::LoanableCollection
+{
+  GenericSequence() = default;
+
+  void resize(size_type /*new_length*/) override
+  {
+    // This kind of collection should only be used with loans
+    throw std::bad_alloc();
+  }
+};
+
+// Whether a sample was published by a writer of the participant of the reader.
+static bool
+_is_local_publication(
+  const CustomSubscriberInfo * info,
+  const eprosima::fastdds::dds::SampleInfo & sinfo)
+{
+  auto sample_writer_guid = eprosima::fastrtps::rtps::iHandle2GUID(sinfo.publication_handle);
+  return sample_writer_guid.guidPrefix == info->data_reader_->guid().guidPrefix;
+}
+
+static bool
+_next_sample_is_local_publication(const CustomSubscriberInfo * info)
+{
+  eprosima::fastdds::dds::SampleInfo sinfo;
+  return info->data_reader_->get_first_untaken_info(&sinfo) == ReturnCode_t::RETCODE_OK &&
+         _is_local_publication(info, sinfo);
+}
+
+// Take the next sample without deserializing it, which requires serialized loans.
+// If it was not published locally after all (e.g. it was replaced in the history since it was
+// checked), it is deserialized into ros_message, and true is returned.
+static bool
+_drop_next_sample(
+  CustomSubscriberInfo * info,
+  void * ros_message,
+  eprosima::fastdds::dds::SampleInfo * sinfo)
+{
+  GenericSequence data_seq;
+  eprosima::fastdds::dds::SampleInfoSeq info_seq;
+  if (info->data_reader_->take(data_seq, info_seq, 1) != ReturnCode_t::RETCODE_OK) {
+    return false;
+  }
+
+  bool deserialized = false;
+  *sinfo = info_seq[0];
+  if (sinfo->valid_data && !_is_local_publication(info, *sinfo)) {
+    auto ser_data = static_cast<SerializedData *>(data_seq.buffer()[0]);
+    auto serialized_message = static_cast<rmw_serialized_message_t *>(ser_data->data);
+    eprosima::fastcdr::FastBuffer buffer(
+      reinterpret_cast<char *>(serialized_message->buffer), serialized_message->buffer_length);
+    eprosima::fastcdr::Cdr deser(
+      buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+    auto type_support = dynamic_cast<rmw_fastrtps_shared_cpp::TypeSupport *>(
+      info->type_support_.get());
+    deserialized = type_support->deserializeROSmessage(
+      deser, ros_message, info->type_support_impl_);
+  }
+
+  info->data_reader_->return_loan(data_seq, info_seq);
+  return deserialized;
+}
+
 rmw_ret_t
 _take(
   const char * identifier,
@@ -72,13 +140,19 @@ _take(
   rmw_message_info_t * message_info,
   rmw_subscription_allocation_t * allocation)
 {
-  (void) allocation;
   *taken = false;
 
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     subscription handle,
     subscription->implementation_identifier, identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  // The message is deserialized in place, no other storage is needed
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      subscription allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
 
   auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "custom subscriber info is null", return RMW_RET_ERROR);
@@ -87,23 +161,38 @@ _take(
 
   rmw_fastrtps_shared_cpp::SerializedData data;
 
-  data.is_cdr_buffer = false;
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE;
   data.data = ros_message;
   data.impl = info->type_support_impl_;
 
+  // Samples of non-plain types can be dropped without deserializing them
+  const bool drop_local_publications =
+    subscription->options.ignore_local_publications && info->can_loan_serialized_messages_;
+
   while (0 < info->data_reader_->get_unread_count()) {
-    if (info->data_reader_->take_next_sample(&data, &sinfo) == ReturnCode_t::RETCODE_OK) {
+    if (drop_local_publications && _next_sample_is_local_publication(info)) {
+      bool deserialized = _drop_next_sample(info, ros_message, &sinfo);
       // Update hasData from listener
       info->listener_->update_has_data(info->data_reader_);
+      if (deserialized) {
+        if (message_info) {
+          _assign_message_info(identifier, message_info, &sinfo);
+        }
+        *taken = true;
+        break;
+      }
+      continue;
+    }
 
-      if (subscription->options.ignore_local_publications) {
-        auto sample_writer_guid =
-          eprosima::fastrtps::rtps::iHandle2GUID(sinfo.publication_handle);
+    if (info->data_reader_->take_next_sample(&data, &sinfo) == ReturnCode_t::RETCODE_OK) {
+      // Update hasData from listener
+      info->listener_->update_has_data(info->data_reader_);
 
-        if (sample_writer_guid.guidPrefix == info->data_reader_->guid().guidPrefix) {
-          // This is a local publication. Ignore it
-          continue;
-        }
+      if (subscription->options.ignore_local_publications &&
+        _is_local_publication(info, sinfo))
+      {
+        // This is a local publication. Ignore it
+        continue;
       }
 
       if (sinfo.valid_data) {
@@ -125,6 +214,23 @@ _take(
   return RMW_RET_OK;
 }
 
+// Collection which deserializes the samples taken into the messages of a message sequence.
+struct MessageSequenceCollection : public eprosima::fastdds::dds::LoanableCollection
+{
+  MessageSequenceCollection(element_type * buffer, size_type maximum)
+  {
+    elements_ = buffer;
+    maximum_ = maximum;
+    has_ownership_ = true;
+  }
+
+  void resize(size_type /*new_length*/) override
+  {
+    // The messages are provided by the caller, the reader never takes more than maximum()
+    throw std::bad_alloc();
+  }
+};
+
 rmw_ret_t
 _take_sequence(
   const char * identifier,
@@ -136,8 +242,6 @@ _take_sequence(
   rmw_subscription_allocation_t * allocation)
 {
   *taken = 0;
-  bool taken_flag = false;
-  rmw_ret_t ret = RMW_RET_OK;
 
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     subscription handle,
@@ -147,6 +251,19 @@ _take_sequence(
   auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "custom subscriber info is null", return RMW_RET_ERROR);
 
+  // Without an allocation, the storage needed by the take only lives for this call
+  CustomSubscriptionAllocation local_storage;
+  CustomSubscriptionAllocation * storage = &local_storage;
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      subscription allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+    storage = static_cast<CustomSubscriptionAllocation *>(allocation->data);
+    RCUTILS_CHECK_FOR_NULL_WITH_MSG(
+      storage, "subscription allocation info is null", return RMW_RET_ERROR);
+  }
+
   // Limit the upper bound of reads to the number unread at the beginning.
   // This prevents any samples that are added after the beginning of the
   // _take_sequence call from being read.
@@ -155,25 +272,77 @@ _take_sequence(
     count = unread_count;
   }
 
-  for (size_t ii = 0; ii < count; ++ii) {
-    taken_flag = false;
-    ret = _take(
-      identifier, subscription, message_sequence->data[*taken],
-      &taken_flag, &message_info_sequence->data[*taken], allocation);
-
-    if (ret != RMW_RET_OK) {
-      break;
+  if (subscription->options.ignore_local_publications) {
+    // Whether a sample is local is only known once it has been taken, so take them one at a time
+    // to deserialize the next one into the same message.
+    rmw_ret_t ret = RMW_RET_OK;
+    for (size_t ii = 0; ii < count; ++ii) {
+      bool taken_flag = false;
+      ret = _take(
+        identifier, subscription, message_sequence->data[*taken],
+        &taken_flag, &message_info_sequence->data[*taken], allocation);
+      if (ret != RMW_RET_OK) {
+        break;
+      }
+      if (taken_flag) {
+        (*taken)++;
+      }
     }
+    message_sequence->size = *taken;
+    message_info_sequence->size = *taken;
+    return ret;
+  }
+
+  std::vector<void *> & data_ptrs = storage->data_ptrs;
+  eprosima::fastdds::dds::SampleInfoSeq & info_seq = storage->info_seq;
+  if (static_cast<size_t>(info_seq.maximum()) < count) {
+    // Growing the length makes the sequence allocate room for that many samples
+    info_seq.length(static_cast<eprosima::fastdds::dds::SampleInfoSeq::size_type>(count));
+  }
+  // Both collections given to take must have the same maximum
+  const auto maximum = info_seq.maximum();
 
-    if (taken_flag) {
-      (*taken)++;
+  // Every sample is deserialized into the next message of the sequence, so that samples without
+  // data do not leave unused messages in between, and the messages stay where the caller put them.
+  message_sequence->size = 0;
+  rmw_fastrtps_shared_cpp::SerializedData data;
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_ROS_MESSAGE_SEQUENCE;
+  data.data = message_sequence;
+  data.impl = info->type_support_impl_;
+  data_ptrs.assign(maximum, &data);
+  MessageSequenceCollection data_values(data_ptrs.data(), maximum);
+  info_seq.length(0);
+
+  // Take all the samples at once, so that the reader is only locked once
+  if (count > 0 && info->data_reader_->take(
+      data_values, info_seq, static_cast<int32_t>(count)) == ReturnCode_t::RETCODE_OK)
+  {
+    const size_t received = static_cast<size_t>(info_seq.length());
+    for (size_t ii = 0; ii < received && *taken < message_sequence->size; ++ii) {
+      const eprosima::fastdds::dds::SampleInfo & sinfo = info_seq[ii];
+      if (sinfo.valid_data) {
+        _assign_message_info(identifier, &message_info_sequence->data[*taken], &sinfo);
+        (*taken)++;
+      }
     }
   }
 
+  // Update hasData from listener
+  info->listener_->update_has_data(info->data_reader_);
+
+  for (size_t ii = 0; ii < *taken; ++ii) {
+    TRACEPOINT(
+      rmw_take,
+      static_cast<const void *>(subscription),
+      static_cast<const void *>(message_sequence->data[ii]),
+      message_info_sequence->data[ii].source_timestamp,
+      true);
+  }
+
   message_sequence->size = *taken;
   message_info_sequence->size = *taken;
 
-  return ret;
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -299,40 +468,36 @@ _take_serialized_message(
   rmw_message_info_t * message_info,
   rmw_subscription_allocation_t * allocation)
 {
-  (void) allocation;
   *taken = false;
 
   RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
     subscription handle,
     subscription->implementation_identifier, identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  // The payload is copied into serialized_message, no other storage is needed
+  if (nullptr != allocation) {
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      subscription allocation,
+      allocation->implementation_identifier, identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  }
 
   auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
   RCUTILS_CHECK_FOR_NULL_WITH_MSG(info, "custom subscriber info is null", return RMW_RET_ERROR);
 
-  eprosima::fastcdr::FastBuffer buffer;
   eprosima::fastdds::dds::SampleInfo sinfo;
 
+  // The payload is copied straight into serialized_message, which is grown as needed.
   rmw_fastrtps_shared_cpp::SerializedData data;
-  data.is_cdr_buffer = true;
-  data.data = &buffer;
-  data.impl = nullptr;    // not used when is_cdr_buffer is true
+  data.type = FASTRTPS_SERIALIZED_DATA_TYPE_RMW_SERIALIZED_MESSAGE;
+  data.data = serialized_message;
+  data.impl = nullptr;    // not used for serialized messages
 
   if (info->data_reader_->take_next_sample(&data, &sinfo) == ReturnCode_t::RETCODE_OK) {
     // Update hasData from listener
     info->listener_->update_has_data(info->data_reader_);
 
     if (sinfo.valid_data) {
-      auto buffer_size = static_cast<size_t>(buffer.getBufferSize());
-      if (serialized_message->buffer_capacity < buffer_size) {
-        auto ret = rmw_serialized_message_resize(serialized_message, buffer_size);
-        if (ret != RMW_RET_OK) {
-          return ret;  // Error message already set
-        }
-      }
-      serialized_message->buffer_length = buffer_size;
-      memcpy(serialized_message->buffer, buffer.getBuffer(), serialized_message->buffer_length);
-
       if (message_info) {
         _assign_message_info(identifier, message_info, &sinfo);
       }
@@ -391,56 +556,17 @@ __rmw_take_serialized_message_with_info(
 
 // ----------------- Loans related code ------------------------- //
 
-struct GenericSequence : public eprosima::fastdds::dds::LoanableCollection
+struct LoanItem
 {
-  GenericSequence() = default;
-
-  void resize(size_type /*new_length*/) override
-  {
-    // This kind of collection should only be used with loans
-    throw std::bad_alloc();
-  }
+  GenericSequence data_seq{};
+  eprosima::fastdds::dds::SampleInfoSeq info_seq{};
+  // What was handed out: the sample, or its serialized message for serialized loans
+  void * loaned_message{nullptr};
 };
 
-struct LoanManager
+struct LoanManager : public LoanPool<LoanItem>
 {
-  struct Item
-  {
-    GenericSequence data_seq{};
-    eprosima::fastdds::dds::SampleInfoSeq info_seq{};
-  };
-
-  explicit LoanManager(const eprosima::fastrtps::ResourceLimitedContainerConfig & items_cfg)
-  : items(items_cfg)
-  {
-  }
-
-  void add_item(std::unique_ptr<Item> item)
-  {
-    std::lock_guard<std::mutex> guard(mtx);
-    items.push_back(std::move(item));
-  }
-
-  std::unique_ptr<Item> erase_item(void * loaned_message)
-  {
-    std::unique_ptr<Item> ret{nullptr};
-
-    std::lock_guard<std::mutex> guard(mtx);
-    for (auto it = items.begin(); it != items.end(); ++it) {
-      if (loaned_message == (*it)->data_seq.buffer()[0]) {
-        ret = std::move(*it);
-        items.erase(it);
-        break;
-      }
-    }
-
-    return ret;
-  }
-
-private:
-  std::mutex mtx;
-  using ItemVector = eprosima::fastrtps::ResourceLimitedVector<std::unique_ptr<Item>>;
-  ItemVector items RCPPUTILS_TSA_GUARDED_BY(mtx);
+  using LoanPool::LoanPool;
 };
 
 void
@@ -451,46 +577,43 @@ __init_subscription_for_loans(
   const auto & qos = info->data_reader_->get_qos();
   bool has_data_sharing = DataSharingKind::OFF != qos.data_sharing().kind();
   subscription->can_loan_messages = has_data_sharing && info->type_support_->is_plain();
-  if (subscription->can_loan_messages) {
+  // Samples of other types are kept serialized by the reader, see TypeSupport::createData()
+  info->can_loan_serialized_messages_ = !info->type_support_->is_plain();
+  if (subscription->can_loan_messages || info->can_loan_serialized_messages_) {
     const auto & allocation_qos = qos.reader_resource_limits().outstanding_reads_allocation;
     info->loan_manager_ = std::make_shared<LoanManager>(allocation_qos);
   }
 }
 
-rmw_ret_t
-__rmw_take_loaned_message_internal(
+static rmw_ret_t
+_take_loan(
   const char * identifier,
-  const rmw_subscription_t * subscription,
+  CustomSubscriberInfo * info,
+  bool serialized,
   void ** loaned_message,
   bool * taken,
   rmw_message_info_t * message_info)
 {
-  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
-  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
-    subscription, subscription->implementation_identifier, identifier,
-    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
-  if (!subscription->can_loan_messages) {
-    RMW_SET_ERROR_MSG("Loaning is not supported");
-    return RMW_RET_UNSUPPORTED;
+  LoanManager::Item * item = info->loan_manager_->get_item();
+  if (nullptr == item) {
+    RMW_SET_ERROR_MSG("Too many outstanding loans");
+    return RMW_RET_ERROR;
   }
 
-  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
-  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
-
-  auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
-
-  auto item = std::make_unique<rmw_fastrtps_shared_cpp::LoanManager::Item>();
-
   while (ReturnCode_t::RETCODE_OK == info->data_reader_->take(item->data_seq, item->info_seq, 1)) {
     if (item->info_seq[0].valid_data) {
       if (nullptr != message_info) {
         _assign_message_info(identifier, message_info, &item->info_seq[0]);
       }
-      *loaned_message = item->data_seq.buffer()[0];
+      item->loaned_message = item->data_seq.buffer()[0];
+      if (serialized) {
+        item->loaned_message = static_cast<SerializedData *>(item->loaned_message)->data;
+      }
+      *loaned_message = item->loaned_message;
       *taken = true;
       info->listener_->update_has_data(info->data_reader_);
 
-      info->loan_manager_->add_item(std::move(item));
+      info->loan_manager_->add_item(item);
 
       return RMW_RET_OK;
     }
@@ -500,11 +623,57 @@ __rmw_take_loaned_message_internal(
   }
 
   // No data available, return loan information.
+  info->loan_manager_->release_item(item);
   *taken = false;
   info->listener_->update_has_data(info->data_reader_);
   return RMW_RET_OK;
 }
 
+static rmw_ret_t
+_return_loan(
+  CustomSubscriberInfo * info,
+  void * loaned_message)
+{
+  LoanManager::Item * item = info->loan_manager_->erase_item(loaned_message);
+  if (item != nullptr) {
+    if (!info->data_reader_->return_loan(item->data_seq, item->info_seq)) {
+      // The item still holds the loan, it cannot be reused
+      RMW_SET_ERROR_MSG("Error returning loan");
+      return RMW_RET_ERROR;
+    }
+
+    info->loan_manager_->release_item(item);
+    return RMW_RET_OK;
+  }
+
+  RMW_SET_ERROR_MSG("Trying to return message not loaned by this subscription");
+  return RMW_RET_ERROR;
+}
+
+rmw_ret_t
+__rmw_take_loaned_message_internal(
+  const char * identifier,
+  const rmw_subscription_t * subscription,
+  void ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription, subscription->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  if (!subscription->can_loan_messages) {
+    RMW_SET_ERROR_MSG("Loaning is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+
+  auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
+  return _take_loan(identifier, info, false, loaned_message, taken, message_info);
+}
+
 rmw_ret_t
 __rmw_return_loaned_message_from_subscription(
   const char * identifier,
@@ -522,18 +691,53 @@ __rmw_return_loaned_message_from_subscription(
   RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
 
   auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
-  std::unique_ptr<rmw_fastrtps_shared_cpp::LoanManager::Item> item;
-  item = info->loan_manager_->erase_item(loaned_message);
-  if (item != nullptr) {
-    if (!info->data_reader_->return_loan(item->data_seq, item->info_seq)) {
-      RMW_SET_ERROR_MSG("Error returning loan");
-      return RMW_RET_ERROR;
-    }
+  return _return_loan(info, loaned_message);
+}
 
-    return RMW_RET_OK;
+rmw_ret_t
+__rmw_take_loaned_serialized_message(
+  const char * identifier,
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t ** loaned_message,
+  bool * taken,
+  rmw_message_info_t * message_info)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription, subscription->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
+  if (!info->can_loan_serialized_messages_) {
+    RMW_SET_ERROR_MSG("Loaning serialized messages is not supported");
+    return RMW_RET_UNSUPPORTED;
   }
 
-  RMW_SET_ERROR_MSG("Trying to return message not loaned by this subscription");
-  return RMW_RET_ERROR;
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+
+  void * loaned_sample = nullptr;
+  rmw_ret_t ret = _take_loan(identifier, info, true, &loaned_sample, taken, message_info);
+  *loaned_message = static_cast<rmw_serialized_message_t *>(loaned_sample);
+  return ret;
+}
+
+rmw_ret_t
+__rmw_return_loaned_serialized_message_from_subscription(
+  const char * identifier,
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * loaned_message)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription, subscription->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
+  if (!info->can_loan_serialized_messages_) {
+    RMW_SET_ERROR_MSG("Loaning serialized messages is not supported");
+    return RMW_RET_UNSUPPORTED;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+
+  return _return_loan(info, loaned_message);
 }
 }  // namespace rmw_fastrtps_shared_cpp
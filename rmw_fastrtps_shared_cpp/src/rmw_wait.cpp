@@ -12,6 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "rcutils/macros.h"
 
 #include "rmw/error_handling.h"
@@ -24,66 +32,321 @@
 #include "types/custom_wait_set_info.hpp"
 #include "types/guard_condition.hpp"
 
-// helper function for wait
-bool
-check_wait_set_for_data(
-  const rmw_subscriptions_t * subscriptions,
-  const rmw_guard_conditions_t * guard_conditions,
-  const rmw_services_t * services,
-  const rmw_clients_t * clients,
-  const rmw_events_t * events)
+// Entities given to rmw_wait, seen as a single array made of the subscriptions, clients,
+// services, events and guard conditions, in that order.
+struct WaitSetEntities
 {
-  if (subscriptions) {
-    for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
+  rmw_subscriptions_t * subscriptions;
+  rmw_guard_conditions_t * guard_conditions;
+  rmw_services_t * services;
+  rmw_clients_t * clients;
+  rmw_events_t * events;
+
+  size_t subscription_count() const
+  {
+    return subscriptions ? subscriptions->subscriber_count : 0;
+  }
+
+  size_t client_count() const
+  {
+    return clients ? clients->client_count : 0;
+  }
+
+  size_t service_count() const
+  {
+    return services ? services->service_count : 0;
+  }
+
+  size_t event_count() const
+  {
+    return events ? events->event_count : 0;
+  }
+
+  size_t guard_condition_count() const
+  {
+    return guard_conditions ? guard_conditions->guard_condition_count : 0;
+  }
+
+  // Get the attachment of each entity, in order.
+  template<typename FunctionT>
+  void
+  for_each_attachment(FunctionT function) const
+  {
+    for (size_t i = 0; i < subscription_count(); ++i) {
       void * data = subscriptions->subscribers[i];
       auto custom_subscriber_info = static_cast<CustomSubscriberInfo *>(data);
-      // Short circuiting out of this function is possible
-      if (custom_subscriber_info && custom_subscriber_info->listener_->hasData()) {
-        return true;
-      }
+      function(custom_subscriber_info->listener_->wait_set_attachment());
     }
-  }
 
-  if (clients) {
-    for (size_t i = 0; i < clients->client_count; ++i) {
+    for (size_t i = 0; i < client_count(); ++i) {
       void * data = clients->clients[i];
       auto custom_client_info = static_cast<CustomClientInfo *>(data);
-      if (custom_client_info && custom_client_info->listener_->hasData()) {
-        return true;
-      }
+      function(custom_client_info->listener_->wait_set_attachment());
     }
-  }
 
-  if (services) {
-    for (size_t i = 0; i < services->service_count; ++i) {
+    for (size_t i = 0; i < service_count(); ++i) {
       void * data = services->services[i];
       auto custom_service_info = static_cast<CustomServiceInfo *>(data);
-      if (custom_service_info && custom_service_info->listener_->hasData()) {
-        return true;
-      }
+      function(custom_service_info->listener_->wait_set_attachment());
     }
-  }
 
-  if (events) {
-    for (size_t i = 0; i < events->event_count; ++i) {
+    for (size_t i = 0; i < event_count(); ++i) {
       auto event = static_cast<rmw_event_t *>(events->events[i]);
       auto custom_event_info = static_cast<CustomEventInfo *>(event->data);
-      if (custom_event_info->getListener()->hasEvent(event->event_type)) {
-        return true;
-      }
+      function(custom_event_info->getListener()->wait_set_attachment());
     }
-  }
 
-  if (guard_conditions) {
-    for (size_t i = 0; i < guard_conditions->guard_condition_count; ++i) {
+    for (size_t i = 0; i < guard_condition_count(); ++i) {
       void * data = guard_conditions->guard_conditions[i];
       auto guard_condition = static_cast<GuardCondition *>(data);
-      if (guard_condition && guard_condition->hasTriggered()) {
-        return true;
+      function(guard_condition->wait_set_attachment());
+    }
+  }
+
+  // Get the array element of an entity.
+  void **
+  slot(size_t entry) const
+  {
+    if (entry < subscription_count()) {
+      return &subscriptions->subscribers[entry];
+    }
+    entry -= subscription_count();
+    if (entry < client_count()) {
+      return &clients->clients[entry];
+    }
+    entry -= client_count();
+    if (entry < service_count()) {
+      return &services->services[entry];
+    }
+    entry -= service_count();
+    if (entry < event_count()) {
+      return &events->events[entry];
+    }
+    entry -= event_count();
+    return &guard_conditions->guard_conditions[entry];
+  }
+
+  // Check whether an entity is ready.
+  // When consume is true, the trigger of a guard condition is reset.
+  bool
+  is_ready(size_t entry, bool consume = false) const
+  {
+    void * data = *slot(entry);
+    if (entry < subscription_count()) {
+      return static_cast<CustomSubscriberInfo *>(data)->listener_->hasData();
+    }
+    entry -= subscription_count();
+    if (entry < client_count()) {
+      return static_cast<CustomClientInfo *>(data)->listener_->hasData();
+    }
+    entry -= client_count();
+    if (entry < service_count()) {
+      return static_cast<CustomServiceInfo *>(data)->listener_->hasData();
+    }
+    entry -= service_count();
+    if (entry < event_count()) {
+      auto event = static_cast<rmw_event_t *>(data);
+      auto custom_event_info = static_cast<CustomEventInfo *>(event->data);
+      return custom_event_info->getListener()->hasEvent(event->event_type);
+    }
+    auto guard_condition = static_cast<GuardCondition *>(data);
+    return consume ? guard_condition->getHasTriggered() : guard_condition->hasTriggered();
+  }
+
+  // Set all the array elements to null.
+  void
+  clear() const
+  {
+    if (subscriptions) {
+      std::fill_n(subscriptions->subscribers, subscription_count(), nullptr);
+    }
+    if (clients) {
+      std::fill_n(clients->clients, client_count(), nullptr);
+    }
+    if (services) {
+      std::fill_n(services->services, service_count(), nullptr);
+    }
+    if (events) {
+      std::fill_n(events->events, event_count(), nullptr);
+    }
+    if (guard_conditions) {
+      std::fill_n(guard_conditions->guard_conditions, guard_condition_count(), nullptr);
+    }
+  }
+};
+
+// Make the entities passed to rmw_wait the ones attached to the wait set.
+// Entities stay attached between calls, so only those which were added or removed since the
+// previous call need to be attached or detached; the others keep their ready queue node.
+// The nodes of added entities are made candidates, so that their state is checked once.
+void
+update_wait_set_attachments(CustomWaitsetInfo * wait_set_info, const WaitSetEntities & entities)
+{
+  using rmw_fastrtps_shared_cpp::WaitSetAttachment;
+  using rmw_fastrtps_shared_cpp::WaitSetReadyQueue;
+
+  WaitSetReadyQueue * readyQueue = &wait_set_info->ready_queue;
+  auto & attachments = wait_set_info->attachments;
+
+  // Fast path: same entities as in the previous call, all of them still attached to us.
+  size_t count = 0;
+  bool unchanged = true;
+  entities.for_each_attachment(
+    [&](const std::shared_ptr<WaitSetAttachment> & attachment) {
+      if (unchanged) {
+        unchanged = count < attachments.size() && attachments[count] == attachment &&
+        attachment->is_attached_to(readyQueue);
       }
+      ++count;
+    });
+  if (unchanged && count == attachments.size()) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<WaitSetAttachment>> current;
+  current.reserve(count);
+  entities.for_each_attachment(
+    [&current](const std::shared_ptr<WaitSetAttachment> & attachment) {
+      current.push_back(attachment);
+    });
+
+  // The positions of the entities may have changed, so they are all set again.
+  // Nodes left without entries are the ones of removed entities.
+  auto & ready_nodes = wait_set_info->ready_nodes;
+  for (auto & ready_node : ready_nodes) {
+    ready_node.second->entries.clear();
+  }
+  std::vector<std::pair<WaitSetAttachment *, WaitSetReadyQueue::Node *>> added;
+  for (size_t entry = 0; entry < current.size(); ++entry) {
+    WaitSetAttachment * attachment = current[entry].get();
+    std::unique_ptr<WaitSetReadyQueue::Node> & node = ready_nodes[attachment];
+    if (!node) {
+      node = std::make_unique<WaitSetReadyQueue::Node>();
+      node->queue = readyQueue;
+    }
+    if (node->entries.empty() && !attachment->is_attached_to(readyQueue)) {
+      added.emplace_back(attachment, node.get());
     }
+    node->entries.push_back(entry);
   }
-  return false;
+
+  for (const auto & attachment : attachments) {
+    auto it = ready_nodes.find(attachment.get());
+    if (it != ready_nodes.end() && it->second->entries.empty()) {
+      attachment->detach(readyQueue);
+    }
+  }
+
+  // Removed nodes cannot be pushed anymore, take them out of the queue and of the candidates.
+  // Kept nodes which were queued are made candidates instead.
+  auto & candidates = wait_set_info->ready_candidates;
+  WaitSetReadyQueue::Node * node = readyQueue->take_all();
+  while (nullptr != node) {
+    WaitSetReadyQueue::Node * next = node->next;
+    WaitSetReadyQueue::release(node);
+    if (!node->entries.empty() && !node->listed) {
+      node->listed = true;
+      candidates.push_back(node);
+    }
+    node = next;
+  }
+  candidates.erase(
+    std::remove_if(
+      candidates.begin(), candidates.end(),
+      [](const WaitSetReadyQueue::Node * candidate) {return candidate->entries.empty();}),
+    candidates.end());
+  for (auto it = ready_nodes.begin(); it != ready_nodes.end(); ) {
+    if (it->second->entries.empty()) {
+      it = ready_nodes.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (const auto & attachment_node : added) {
+    if (!attachment_node.second->listed) {
+      attachment_node.second->listed = true;
+      candidates.push_back(attachment_node.second);
+    }
+    attachment_node.first->attach(attachment_node.second);
+  }
+
+  attachments = std::move(current);
+}
+
+// Add the entities notified since the last call to the candidates, and keep the ready ones.
+bool
+collect_ready_entities(CustomWaitsetInfo * wait_set_info, const WaitSetEntities & entities)
+{
+  using rmw_fastrtps_shared_cpp::WaitSetReadyQueue;
+
+  auto & candidates = wait_set_info->ready_candidates;
+  wait_set_info->ready_queue.clear_signal();
+  WaitSetReadyQueue::Node * node = wait_set_info->ready_queue.take_all();
+  while (nullptr != node) {
+    // The node may be pushed again as soon as it is released
+    WaitSetReadyQueue::Node * next = node->next;
+    WaitSetReadyQueue::release(node);
+    if (!node->listed) {
+      node->listed = true;
+      candidates.push_back(node);
+    }
+    node = next;
+  }
+
+  // Entities which were ready on the previous call are still candidates, as they are only
+  // notified again if their state changes.
+  size_t ready_count = 0;
+  for (WaitSetReadyQueue::Node * candidate : candidates) {
+    bool ready = false;
+    for (size_t entry : candidate->entries) {
+      if (entities.is_ready(entry)) {
+        ready = true;
+        break;
+      }
+    }
+    if (ready) {
+      candidates[ready_count++] = candidate;
+    } else {
+      candidate->listed = false;
+    }
+  }
+  candidates.resize(ready_count);
+  return ready_count > 0;
+}
+
+// Busy-wait for a short moment, for longer as iteration grows, then yield.
+static void
+spin_backoff(unsigned int iteration)
+{
+  constexpr unsigned int max_pause_shift = 6;
+  if (iteration > max_pause_shift) {
+    std::this_thread::yield();
+    return;
+  }
+  for (unsigned int i = 0; i < (1u << iteration); ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__ ("yield");
+#endif
+  }
+}
+
+// Poll the ready queue until it is not empty or the deadline is reached.
+template<typename TimePointT>
+bool
+spin_until_not_empty(
+  const rmw_fastrtps_shared_cpp::WaitSetReadyQueue * readyQueue, const TimePointT & deadline)
+{
+  unsigned int iteration = 0;
+  while (readyQueue->empty()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    spin_backoff(iteration++);
+  }
+  return true;
 }
 
 namespace rmw_fastrtps_shared_cpp
@@ -115,135 +378,79 @@ __rmw_wait(
   // - Heap is corrupt.
   // In all three cases, it's better if this crashes soon enough.
   auto wait_set_info = static_cast<CustomWaitsetInfo *>(wait_set->data);
-  std::mutex * conditionMutex = &wait_set_info->condition_mutex;
-  std::condition_variable * conditionVariable = &wait_set_info->condition;
-
-  if (subscriptions) {
-    for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
-      void * data = subscriptions->subscribers[i];
-      auto custom_subscriber_info = static_cast<CustomSubscriberInfo *>(data);
-      custom_subscriber_info->listener_->attachCondition(conditionMutex, conditionVariable);
-    }
-  }
-
-  if (clients) {
-    for (size_t i = 0; i < clients->client_count; ++i) {
-      void * data = clients->clients[i];
-      auto custom_client_info = static_cast<CustomClientInfo *>(data);
-      custom_client_info->listener_->attachCondition(conditionMutex, conditionVariable);
-    }
-  }
-
-  if (services) {
-    for (size_t i = 0; i < services->service_count; ++i) {
-      void * data = services->services[i];
-      auto custom_service_info = static_cast<CustomServiceInfo *>(data);
-      custom_service_info->listener_->attachCondition(conditionMutex, conditionVariable);
-    }
-  }
-
-  if (events) {
-    for (size_t i = 0; i < events->event_count; ++i) {
-      auto event = static_cast<rmw_event_t *>(events->events[i]);
-      auto custom_event_info = static_cast<CustomEventInfo *>(event->data);
-      custom_event_info->getListener()->attachCondition(conditionMutex, conditionVariable);
-    }
-  }
-
-  if (guard_conditions) {
-    for (size_t i = 0; i < guard_conditions->guard_condition_count; ++i) {
-      void * data = guard_conditions->guard_conditions[i];
-      auto guard_condition = static_cast<GuardCondition *>(data);
-      guard_condition->attachCondition(conditionMutex, conditionVariable);
-    }
-  }
-
-  // This mutex prevents any of the listeners
-  // to change the internal state and notify the condition
-  // between the call to hasData() / hasTriggered() and wait()
-  // otherwise the decision to wait might be incorrect
-  std::unique_lock<std::mutex> lock(*conditionMutex);
+  WaitSetReadyQueue * readyQueue = &wait_set_info->ready_queue;
 
-  bool hasData = check_wait_set_for_data(
-    subscriptions, guard_conditions, services, clients, events);
-  auto predicate = [subscriptions, guard_conditions, services, clients, events]() {
-      return check_wait_set_for_data(subscriptions, guard_conditions, services, clients, events);
-    };
+  const WaitSetEntities entities{subscriptions, guard_conditions, services, clients, events};
+  update_wait_set_attachments(wait_set_info, entities);
 
   bool timeout = false;
-  if (!hasData) {
-    if (!wait_timeout) {
-      conditionVariable->wait(lock, predicate);
-    } else if (wait_timeout->sec > 0 || wait_timeout->nsec > 0) {
-      auto n = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::seconds(wait_timeout->sec));
-      n += std::chrono::nanoseconds(wait_timeout->nsec);
-      timeout = !conditionVariable->wait_for(lock, n, predicate);
-    } else {
-      timeout = true;
-    }
-  }
-
-  // Unlock the condition variable mutex to prevent deadlocks that can occur if
-  // a listener triggers while the condition variable is being detached.
-  // Listeners will no longer be prevented from changing their internal state,
-  // but that should not cause issues (if a listener has data / has triggered
-  // after we check, it will be caught on the next call to this function).
-  lock.unlock();
-
-  if (subscriptions) {
-    for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
-      void * data = subscriptions->subscribers[i];
-      auto custom_subscriber_info = static_cast<CustomSubscriberInfo *>(data);
-      custom_subscriber_info->listener_->detachCondition();
-      if (!custom_subscriber_info->listener_->hasData()) {
-        subscriptions->subscribers[i] = 0;
+  if (!collect_ready_entities(wait_set_info, entities)) {
+    if (!wait_timeout || wait_timeout->sec > 0 || wait_timeout->nsec > 0) {
+      auto now = std::chrono::steady_clock::now();
+      auto deadline = now;
+      if (wait_timeout) {
+        deadline += std::chrono::seconds(wait_timeout->sec);
+        deadline += std::chrono::nanoseconds(wait_timeout->nsec);
       }
-    }
-  }
 
-  if (clients) {
-    for (size_t i = 0; i < clients->client_count; ++i) {
-      void * data = clients->clients[i];
-      auto custom_client_info = static_cast<CustomClientInfo *>(data);
-      custom_client_info->listener_->detachCondition();
-      if (!custom_client_info->listener_->hasData()) {
-        clients->clients[i] = 0;
+      bool spun = false;
+      auto spin_period = std::chrono::nanoseconds(
+        wait_set_info->spin_period_ns.load(std::memory_order_relaxed));
+      if (spin_period.count() > 0) {
+        auto spin_deadline = now + spin_period;
+        if (wait_timeout && deadline < spin_deadline) {
+          spin_deadline = deadline;
+        }
+        while (spin_until_not_empty(readyQueue, spin_deadline)) {
+          if (collect_ready_entities(wait_set_info, entities)) {
+            spun = true;
+            break;
+          }
+        }
       }
-    }
-  }
 
-  if (services) {
-    for (size_t i = 0; i < services->service_count; ++i) {
-      void * data = services->services[i];
-      auto custom_service_info = static_cast<CustomServiceInfo *>(data);
-      custom_service_info->listener_->detachCondition();
-      if (!custom_service_info->listener_->hasData()) {
-        services->services[i] = 0;
+      if (spun) {
+        wait_set_info->spin_wakeups.fetch_add(1, std::memory_order_relaxed);
       }
+      while (!spun && !timeout) {
+        if (!wait_timeout) {
+          readyQueue->wait();
+        } else {
+          timeout = !readyQueue->wait_until(deadline);
+        }
+        // Notified entities may not be ready anymore (e.g. data already taken by someone else),
+        // in which case we need to keep waiting.
+        if (collect_ready_entities(wait_set_info, entities)) {
+          wait_set_info->block_wakeups.fetch_add(1, std::memory_order_relaxed);
+          timeout = false;
+          break;
+        }
+      }
+    } else {
+      timeout = true;
     }
   }
 
-  if (events) {
-    for (size_t i = 0; i < events->event_count; ++i) {
-      auto event = static_cast<rmw_event_t *>(events->events[i]);
-      auto custom_event_info = static_cast<CustomEventInfo *>(event->data);
-      custom_event_info->getListener()->detachCondition();
-      if (!custom_event_info->getListener()->hasEvent(event->event_type)) {
-        events->events[i] = nullptr;
+  // Only ready entities are kept, guard conditions are reset while doing so.
+  auto & ready_entries = wait_set_info->ready_entries;
+  ready_entries.clear();
+  for (WaitSetReadyQueue::Node * candidate : wait_set_info->ready_candidates) {
+    for (size_t entry : candidate->entries) {
+      if (entities.is_ready(entry, true)) {
+        void ** slot = entities.slot(entry);
+        ready_entries.emplace_back(slot, *slot);
       }
     }
   }
+  entities.clear();
+  for (const auto & ready_entry : ready_entries) {
+    *ready_entry.first = ready_entry.second;
+  }
 
-  if (guard_conditions) {
-    for (size_t i = 0; i < guard_conditions->guard_condition_count; ++i) {
-      void * data = guard_conditions->guard_conditions[i];
-      auto guard_condition = static_cast<GuardCondition *>(data);
-      guard_condition->detachCondition();
-      if (!guard_condition->getHasTriggered()) {
-        guard_conditions->guard_conditions[i] = 0;
-      }
-    }
+  // Entities which are still ready are not notified again, keep the file descriptor readable
+  // until they are checked by the next call.
+  if (!wait_set_info->ready_candidates.empty()) {
+    readyQueue->signal();
   }
 
   return timeout ? RMW_RET_TIMEOUT : RMW_RET_OK;
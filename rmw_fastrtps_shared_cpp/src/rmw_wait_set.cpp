@@ -12,6 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+
+#include "rcutils/env.h"
+#include "rcutils/logging_macros.h"
 #include "rcutils/macros.h"
 
 #include "rmw/allocators.h"
@@ -23,6 +34,37 @@
 
 #include "types/custom_wait_set_info.hpp"
 
+// Spin periods must be shorter than this, as a wait set spinning longer would rather block.
+static constexpr int64_t max_spin_period_ns = 2000000000;
+
+// Get the default spin period of wait sets from RMW_FASTRTPS_WAIT_SPIN_US, in nanoseconds.
+static int64_t
+get_spin_period_from_env()
+{
+  const char * env_value;
+  const char * error_str = rcutils_get_env("RMW_FASTRTPS_WAIT_SPIN_US", &env_value);
+  if (error_str != NULL) {
+    RCUTILS_LOG_DEBUG_NAMED("rmw_fastrtps_shared_cpp", "Error getting env var: %s\n", error_str);
+    return 0;
+  }
+  if (env_value == nullptr || env_value[0] == '\0') {
+    return 0;
+  }
+  char * end = nullptr;
+  errno = 0;
+  long long spin_period_us = std::strtoll(env_value, &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || *end != '\0' || spin_period_us < 0 ||
+    spin_period_us >= max_spin_period_ns / 1000)
+  {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_fastrtps_shared_cpp",
+      "Value %s invalid for environment variable RMW_FASTRTPS_WAIT_SPIN_US"
+      ". Wait sets will not spin.", env_value);
+    return 0;
+  }
+  return static_cast<int64_t>(spin_period_us) * 1000;
+}
+
 namespace rmw_fastrtps_shared_cpp
 {
 rmw_wait_set_t *
@@ -59,7 +101,7 @@ __rmw_create_wait_set(const char * identifier, rmw_context_t * context, size_t m
     goto fail,
     // cppcheck-suppress syntaxError
     CustomWaitsetInfo, );
-  (void) wait_set_info;
+  wait_set_info->spin_period_ns.store(get_spin_period_from_env(), std::memory_order_relaxed);
 
   return wait_set;
 
@@ -93,6 +135,16 @@ __rmw_destroy_wait_set(const char * identifier, rmw_wait_set_t * wait_set)
 
   if (wait_set->data) {
     if (wait_set_info) {
+      // Entities outlive the wait set, make sure they do not notify it anymore.
+      for (const auto & attachment : wait_set_info->attachments) {
+        attachment->detach(&wait_set_info->ready_queue);
+      }
+#ifdef __linux__
+      int event_fd = wait_set_info->ready_queue.event_fd();
+      if (event_fd >= 0) {
+        close(event_fd);
+      }
+#endif
       RMW_TRY_DESTRUCTOR(
         wait_set_info->~CustomWaitsetInfo(), wait_set_info, result = RMW_RET_ERROR)
     }
@@ -103,4 +155,104 @@ __rmw_destroy_wait_set(const char * identifier, rmw_wait_set_t * wait_set)
   RCUTILS_CAN_RETURN_WITH_ERROR_OF(RMW_RET_ERROR);  // on completion
   return result;
 }
+
+rmw_ret_t
+__rmw_wait_set_get_fd(const char * identifier, rmw_wait_set_t * wait_set, int * fd)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    wait set handle,
+    wait_set->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  RMW_CHECK_ARGUMENT_FOR_NULL(fd, RMW_RET_INVALID_ARGUMENT);
+
+#ifdef __linux__
+  auto wait_set_info = static_cast<CustomWaitsetInfo *>(wait_set->data);
+  auto & ready_queue = wait_set_info->ready_queue;
+  int event_fd = ready_queue.event_fd();
+  if (event_fd < 0) {
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+      RMW_SET_ERROR_MSG("failed to create eventfd for wait set");
+      return RMW_RET_ERROR;
+    }
+    ready_queue.set_event_fd(event_fd);
+    if (!wait_set_info->ready_candidates.empty()) {
+      ready_queue.signal();
+    }
+  }
+  *fd = event_fd;
+  return RMW_RET_OK;
+#else
+  (void)fd;
+  RMW_SET_ERROR_MSG("wait set file descriptors are only available on Linux");
+  return RMW_RET_UNSUPPORTED;
+#endif
+}
+
+rmw_ret_t
+__rmw_wait_set_set_spin_period(
+  const char * identifier,
+  rmw_wait_set_t * wait_set,
+  const rmw_time_t * spin_period)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    wait set handle,
+    wait_set->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  RMW_CHECK_ARGUMENT_FOR_NULL(spin_period, RMW_RET_INVALID_ARGUMENT);
+  // Both are checked before adding them, so that the sum cannot overflow
+  if (spin_period->sec >= static_cast<uint64_t>(max_spin_period_ns) / 1000000000u ||
+    spin_period->nsec >= 1000000000u)
+  {
+    RMW_SET_ERROR_MSG("spin period must be shorter than two seconds");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  auto wait_set_info = static_cast<CustomWaitsetInfo *>(wait_set->data);
+  wait_set_info->spin_period_ns.store(
+    static_cast<int64_t>(spin_period->sec * 1000000000 + spin_period->nsec),
+    std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+__rmw_wait_set_get_wakeup_counts(
+  const char * identifier,
+  const rmw_wait_set_t * wait_set,
+  uint64_t * spin_wakeups,
+  uint64_t * block_wakeups)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    wait set handle,
+    wait_set->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  RMW_CHECK_ARGUMENT_FOR_NULL(spin_wakeups, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(block_wakeups, RMW_RET_INVALID_ARGUMENT);
+
+  auto wait_set_info = static_cast<const CustomWaitsetInfo *>(wait_set->data);
+  *spin_wakeups = wait_set_info->spin_wakeups.load(std::memory_order_relaxed);
+  *block_wakeups = wait_set_info->block_wakeups.load(std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+__rmw_wait_set_get_suppressed_notification_count(
+  const char * identifier,
+  const rmw_wait_set_t * wait_set,
+  uint64_t * count)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    wait set handle,
+    wait_set->implementation_identifier, identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION)
+  RMW_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+
+  auto wait_set_info = static_cast<const CustomWaitsetInfo *>(wait_set->data);
+  *count = wait_set_info->ready_queue.suppressed_notifications();
+  return RMW_RET_OK;
+}
 }  // namespace rmw_fastrtps_shared_cpp
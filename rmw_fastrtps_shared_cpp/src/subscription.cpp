@@ -46,6 +46,10 @@ destroy_subscription(
     // Get RMW Subscriber
     auto info = static_cast<CustomSubscriberInfo *>(subscription->data);
 
+    if (info->decompressing_readers_) {
+      info->decompressing_readers_->remove(info->data_reader_->guid());
+    }
+
     // Delete DataReader
     ReturnCode_t ret = participant_info->subscriber_->delete_datareader(info->data_reader_);
     if (ReturnCode_t::RETCODE_OK != ret) {
@@ -0,0 +1,32 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TYPES__CUSTOM_SUBSCRIPTION_ALLOCATION_HPP_
+#define TYPES__CUSTOM_SUBSCRIPTION_ALLOCATION_HPP_
+
+#include <vector>
+
+#include "fastdds/dds/subscriber/SampleInfo.hpp"
+
+// Storage reused by the takes done with a subscription allocation.
+// Messages are deserialized in place into the ones given by the caller, so this only holds what
+// the takes themselves need. It grows to the largest count taken at once, and is kept afterwards,
+// so that steady-state takes do not allocate.
+struct CustomSubscriptionAllocation
+{
+  std::vector<void *> data_ptrs;
+  eprosima::fastdds::dds::SampleInfoSeq info_seq;
+};
+
+#endif  // TYPES__CUSTOM_SUBSCRIPTION_ALLOCATION_HPP_
@@ -15,13 +15,35 @@
 #ifndef TYPES__CUSTOM_WAIT_SET_INFO_HPP_
 #define TYPES__CUSTOM_WAIT_SET_INFO_HPP_
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
 
 typedef struct CustomWaitsetInfo
 {
-  std::condition_variable condition;
-  std::mutex condition_mutex;
+  rmw_fastrtps_shared_cpp::WaitSetReadyQueue ready_queue;
+  // Entities attached to this wait set by the last call to rmw_wait, in the order they were
+  // passed to it.
+  std::vector<std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment>> attachments;
+  // Ready queue nodes of the attached entities, one per distinct attachment, kept for as long as
+  // the entity stays attached.
+  std::unordered_map<
+    const rmw_fastrtps_shared_cpp::WaitSetAttachment *,
+    std::unique_ptr<rmw_fastrtps_shared_cpp::WaitSetReadyQueue::Node>> ready_nodes;
+  // Nodes of the entities which were notified or ready, and need to be checked.
+  std::vector<rmw_fastrtps_shared_cpp::WaitSetReadyQueue::Node *> ready_candidates;
+  // Scratch storage for the array elements kept by rmw_wait.
+  std::vector<std::pair<void **, void *>> ready_entries;
+  // How long rmw_wait polls the ready queue before blocking, in nanoseconds (0 never polls).
+  std::atomic<int64_t> spin_period_ns{0};
+  // Calls to rmw_wait which found ready entities while polling, or after blocking.
+  std::atomic<uint64_t> spin_wakeups{0};
+  std::atomic<uint64_t> block_wakeups{0};
 } CustomWaitsetInfo;
 
 #endif  // TYPES__CUSTOM_WAIT_SET_INFO_HPP_
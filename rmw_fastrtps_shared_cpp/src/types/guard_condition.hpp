@@ -18,51 +18,33 @@
 #include <array>
 #include <atomic>
 #include <cassert>
-#include <condition_variable>
-#include <mutex>
+#include <memory>
 #include <utility>
 
-#include "rcpputils/thread_safety_annotations.hpp"
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
 
 class GuardCondition
 {
 public:
   GuardCondition()
   : hasTriggered_(false),
-    conditionMutex_(nullptr), conditionVariable_(nullptr) {}
+    wait_set_attachment_(std::make_shared<rmw_fastrtps_shared_cpp::WaitSetAttachment>()) {}
 
+  // Never blocks, so that guard conditions can be triggered from real-time threads.
+  // Waiters either see the flag when checking their ready queue, or are woken up by the
+  // notification which follows.
   void
   trigger()
   {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-
-    if (conditionMutex_ != nullptr) {
-      std::unique_lock<std::mutex> clock(*conditionMutex_);
-      // the change to hasTriggered_ needs to be mutually exclusive with
-      // rmw_wait() which checks hasTriggered() and decides if wait() needs to
-      // be called
-      hasTriggered_ = true;
-      clock.unlock();
-      conditionVariable_->notify_one();
-    } else {
-      hasTriggered_ = true;
-    }
-  }
-
-  void
-  attachCondition(std::mutex * conditionMutex, std::condition_variable * conditionVariable)
-  {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = conditionMutex;
-    conditionVariable_ = conditionVariable;
+    bool was_triggered = hasTriggered_.exchange(true);
+    wait_set_attachment_->notify_if_became_ready(!was_triggered);
   }
 
-  void
-  detachCondition()
+  /// Get the link to the wait sets this guard condition is attached to.
+  const std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> &
+  wait_set_attachment() const
   {
-    std::lock_guard<std::mutex> lock(internalMutex_);
-    conditionMutex_ = nullptr;
-    conditionVariable_ = nullptr;
+    return wait_set_attachment_;
   }
 
   bool
@@ -78,10 +60,8 @@ public:
   }
 
 private:
-  std::mutex internalMutex_;
   std::atomic_bool hasTriggered_;
-  std::mutex * conditionMutex_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
-  std::condition_variable * conditionVariable_ RCPPUTILS_TSA_GUARDED_BY(internalMutex_);
+  std::shared_ptr<rmw_fastrtps_shared_cpp::WaitSetAttachment> wait_set_attachment_;
 };
 
 #endif  // TYPES__GUARD_CONDITION_HPP_
@@ -0,0 +1,164 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TYPES__LOAN_POOL_HPP_
+#define TYPES__LOAN_POOL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "fastrtps/utils/collections/ResourceLimitedContainerConfig.hpp"
+
+#include "rcpputils/thread_safety_annotations.hpp"
+
+// Hash of the message loaned, spreading the addresses of the samples over the index.
+struct LoanedMessageHash
+{
+  size_t operator()(const void * loaned_message) const
+  {
+    auto key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(loaned_message));
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+  }
+};
+
+// Pool of the items holding the loans of a subscription, indexed by the message loaned.
+// Items are preallocated as allowed by outstanding_reads_allocation, so that taking and
+// returning loans does not allocate, and finding the item of a message does not scan them.
+// ItemT must have a `void * loaned_message` member.
+template<typename ItemT, typename HashT = LoanedMessageHash>
+class LoanPool
+{
+public:
+  using Item = ItemT;
+
+  explicit LoanPool(const eprosima::fastrtps::ResourceLimitedContainerConfig & items_cfg)
+  : max_items(items_cfg.maximum),
+    increment((std::max)(items_cfg.increment, static_cast<size_t>(1u)))
+  {
+    std::lock_guard<std::mutex> guard(mtx);
+    grow((std::min)(items_cfg.initial, max_items));
+  }
+
+  /// Get a free item to take a loan, nullptr if as many loans as allowed are outstanding.
+  Item * get_item()
+  {
+    std::lock_guard<std::mutex> guard(mtx);
+    if (free_items.empty() && !grow(increment)) {
+      return nullptr;
+    }
+    Item * item = free_items.back();
+    free_items.pop_back();
+    return item;
+  }
+
+  /// Give back an item which does not hold a loan anymore.
+  void release_item(Item * item)
+  {
+    item->loaned_message = nullptr;
+    std::lock_guard<std::mutex> guard(mtx);
+    free_items.push_back(item);
+  }
+
+  /// Index an item which holds the loan of item->loaned_message.
+  void add_item(Item * item)
+  {
+    std::lock_guard<std::mutex> guard(mtx);
+    insert(item);
+  }
+
+  /// Remove the item holding the loan of a message from the index, nullptr if not found.
+  Item * erase_item(const void * loaned_message)
+  {
+    std::lock_guard<std::mutex> guard(mtx);
+    const size_t mask = index.size() - 1;
+    size_t pos = bucket(loaned_message);
+    while (nullptr != index[pos] && loaned_message != index[pos]->loaned_message) {
+      pos = (pos + 1) & mask;
+    }
+    Item * ret = index[pos];
+    if (nullptr == ret) {
+      return nullptr;
+    }
+    // Shift back the items after it, so that lookups do not stop early at the hole.
+    size_t hole = pos;
+    for (size_t next = (pos + 1) & mask; nullptr != index[next]; next = (next + 1) & mask) {
+      size_t home = bucket(index[next]->loaned_message);
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        index[hole] = index[next];
+        hole = next;
+      }
+    }
+    index[hole] = nullptr;
+    return ret;
+  }
+
+private:
+  size_t bucket(const void * loaned_message) const RCPPUTILS_TSA_REQUIRES(mtx)
+  {
+    return HashT()(loaned_message) & (index.size() - 1);
+  }
+
+  void insert(Item * item) RCPPUTILS_TSA_REQUIRES(mtx)
+  {
+    size_t pos = bucket(item->loaned_message);
+    while (nullptr != index[pos]) {
+      pos = (pos + 1) & (index.size() - 1);
+    }
+    index[pos] = item;
+  }
+
+  bool grow(size_t count) RCPPUTILS_TSA_REQUIRES(mtx)
+  {
+    count = (std::min)(count, max_items - items.size());
+    if (0u == count && !items.empty()) {
+      return false;
+    }
+    count = (std::max)(count, static_cast<size_t>(1u));
+    for (size_t i = 0; i < count; ++i) {
+      items.emplace_back(new Item());
+      free_items.push_back(items.back().get());
+    }
+    free_items.reserve(items.size());
+
+    // Keep the index at most half full
+    size_t index_size = 2u;
+    while (index_size < 2u * items.size()) {
+      index_size *= 2u;
+    }
+    if (index_size != index.size()) {
+      std::vector<Item *> old_index(index_size, nullptr);
+      old_index.swap(index);
+      for (Item * item : old_index) {
+        if (nullptr != item) {
+          insert(item);
+        }
+      }
+    }
+    return true;
+  }
+
+  std::mutex mtx;
+  const size_t max_items;
+  const size_t increment;
+  std::vector<std::unique_ptr<Item>> items RCPPUTILS_TSA_GUARDED_BY(mtx);
+  std::vector<Item *> free_items RCPPUTILS_TSA_GUARDED_BY(mtx);
+  // Open addressing hash table of the items holding a loan
+  std::vector<Item *> index RCPPUTILS_TSA_GUARDED_BY(mtx);
+};
+
+#endif  // TYPES__LOAN_POOL_HPP_
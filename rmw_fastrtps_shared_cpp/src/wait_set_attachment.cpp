@@ -0,0 +1,114 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ctime>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rmw_fastrtps_shared_cpp
+{
+
+#ifdef __linux__
+static_assert(
+  sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+  "futex words must be plain 32 bits integers");
+
+// Block while the futex word is equal to expected, for at most timeout (forever if NULL).
+static void
+futex_wait(std::atomic<uint32_t> * word, uint32_t expected, const struct timespec * timeout)
+{
+  syscall(
+    SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE, expected, timeout,
+    nullptr, 0);
+}
+
+static void
+futex_wake_one(std::atomic<uint32_t> * word)
+{
+  syscall(
+    SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+void
+WaitSetReadyQueue::wake()
+{
+#ifdef __linux__
+  // Either the waiter sees the new count and does not sleep, or it registered itself as
+  // sleeping before and we wake it up.
+  wake_count_.fetch_add(1, std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_seq_cst) != 0) {
+    futex_wake_one(&wake_count_);
+  }
+#else
+  {
+    // Taking the mutex makes sure the waiter is either blocked, or has not checked the
+    // queue yet.
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  condition_.notify_one();
+#endif
+}
+
+bool
+WaitSetReadyQueue::wait_for_push(const std::chrono::steady_clock::time_point * deadline)
+{
+#ifdef __linux__
+  bool pushed = true;
+  sleeping_.fetch_add(1, std::memory_order_seq_cst);
+  while (true) {
+    uint32_t wake_count = wake_count_.load(std::memory_order_seq_cst);
+    if (head_.load(std::memory_order_seq_cst) != nullptr) {
+      break;
+    }
+    if (nullptr == deadline) {
+      futex_wait(&wake_count_, wake_count, nullptr);
+      continue;
+    }
+    auto remaining = *deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::steady_clock::duration::zero()) {
+      pushed = false;
+      break;
+    }
+    auto remaining_s = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(remaining_s.count());
+    timeout.tv_nsec = static_cast<long>(  // NOLINT(runtime/int)
+      std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - remaining_s).count());
+    futex_wait(&wake_count_, wake_count, &timeout);
+  }
+  sleeping_.fetch_sub(1, std::memory_order_relaxed);
+  return pushed;
+#else
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto predicate = [this]() {return !empty();};
+  if (nullptr == deadline) {
+    condition_.wait(lock, predicate);
+    return true;
+  }
+  return condition_.wait_until(lock, *deadline, predicate);
+#endif
+}
+
+}  // namespace rmw_fastrtps_shared_cpp
@@ -0,0 +1,123 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+// Messages of 1 KiB to 4 MiB, with a body which compresses well (e.g. a point cloud with many
+// empty fields) or not at all (e.g. an already compressed image).
+void
+payload_args(benchmark::internal::Benchmark * b)
+{
+  for (int64_t size : {1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024}) {
+    b->Args({size, 1});
+    b->Args({size, 0});
+  }
+  b->ArgNames({"size", "compressible"});
+}
+
+}  // namespace
+
+class CompressionPerformanceTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    if (!rmw_fastrtps_shared_cpp::is_compression_available()) {
+      st.SkipWithError("built without zstd");
+      return;
+    }
+    const size_t size = static_cast<size_t>(st.range(0));
+    const bool compressible = st.range(1) != 0;
+    message.assign(size, 0u);
+    message[1] = 0x01;  // Little endian CDR
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (size_t i = 4; i < size; ++i) {
+      if (compressible) {
+        message[i] = (i % 8 < 6) ? 0u : static_cast<uint8_t>(distribution(generator));
+      } else {
+        message[i] = static_cast<uint8_t>(distribution(generator));
+      }
+    }
+    compressed_length = 0u;
+    is_compressed = rmw_fastrtps_shared_cpp::compress_payload(
+      message.data(), message.size(), 1, compressed, compressed_length);
+    decompressed.resize(message.size());
+
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+  }
+
+protected:
+  std::vector<uint8_t> message;
+  std::vector<uint8_t> compressed;
+  std::vector<uint8_t> decompressed;
+  size_t compressed_length;
+  bool is_compressed;
+};
+
+// Time to compress a message before writing it, and the ratio gained on the wire.
+BENCHMARK_DEFINE_F(CompressionPerformanceTest, compress)(benchmark::State & st)
+{
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    size_t length = 0u;
+    bool ret = rmw_fastrtps_shared_cpp::compress_payload(
+      message.data(), message.size(), 1, compressed, length);
+    benchmark::DoNotOptimize(ret);
+    benchmark::ClobberMemory();
+  }
+  st.SetBytesProcessed(static_cast<int64_t>(st.iterations() * message.size()));
+  st.counters["ratio"] = is_compressed ?
+    static_cast<double>(message.size()) / static_cast<double>(compressed_length) : 1.0;
+}
+BENCHMARK_REGISTER_F(CompressionPerformanceTest, compress)->Apply(payload_args);
+
+// Time to decompress a message before deserializing it.
+BENCHMARK_DEFINE_F(CompressionPerformanceTest, decompress)(benchmark::State & st)
+{
+  if (!is_compressed) {
+    st.SkipWithError("message is not compressible");
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    bool ret = rmw_fastrtps_shared_cpp::decompress_payload(
+      compressed.data(), compressed_length, decompressed.data(), decompressed.size());
+    if (!ret) {
+      st.SkipWithError("decompress_payload failed");
+      break;
+    }
+    benchmark::ClobberMemory();
+  }
+  st.SetBytesProcessed(static_cast<int64_t>(st.iterations() * message.size()));
+}
+BENCHMARK_REGISTER_F(CompressionPerformanceTest, decompress)->Apply(payload_args);
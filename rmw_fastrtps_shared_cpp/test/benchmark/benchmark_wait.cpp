@@ -0,0 +1,168 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_fastrtps_shared_cpp/custom_subscriber_info.hpp"
+#include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
+
+#include "types/guard_condition.hpp"
+
+using performance_test_fixture::PerformanceTest;
+using rmw_fastrtps_shared_cpp::__rmw_create_wait_set;
+using rmw_fastrtps_shared_cpp::__rmw_destroy_wait_set;
+using rmw_fastrtps_shared_cpp::__rmw_wait;
+
+namespace
+{
+
+constexpr const char * identifier = "benchmark_wait";
+
+// Wait on 1 to 10000 entities, with none, one or all of them ready.
+void
+wait_args(benchmark::internal::Benchmark * b)
+{
+  for (int64_t entity_count : {1, 10, 100, 1000, 10000}) {
+    b->Args({entity_count, 0});
+    b->Args({entity_count, 1});
+    if (entity_count > 1) {
+      b->Args({entity_count, entity_count});
+    }
+  }
+  b->ArgNames({"entities", "ready"});
+}
+
+}  // namespace
+
+class WaitPerformanceTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    context = rmw_get_zero_initialized_context();
+    context.implementation_identifier = identifier;
+    wait_set = __rmw_create_wait_set(identifier, &context, 0);
+    if (nullptr == wait_set) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+    }
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    if (nullptr != wait_set && RMW_RET_OK != __rmw_destroy_wait_set(identifier, wait_set)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+    }
+  }
+
+protected:
+  // Wait without blocking, the entities given have already been made ready or not.
+  void wait(
+    benchmark::State & st,
+    rmw_subscriptions_t * subscriptions,
+    rmw_guard_conditions_t * guard_conditions)
+  {
+    rmw_ret_t ret = __rmw_wait(
+      identifier, subscriptions, guard_conditions, nullptr, nullptr, nullptr, wait_set,
+      &zero_timeout);
+    if (RMW_RET_OK != ret && RMW_RET_TIMEOUT != ret) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+    }
+  }
+
+  rmw_context_t context;
+  rmw_wait_set_t * wait_set = nullptr;
+  const rmw_time_t zero_timeout{0, 0};
+};
+
+BENCHMARK_DEFINE_F(WaitPerformanceTest, wait_subscriptions)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const size_t ready = static_cast<size_t>(st.range(1));
+  std::vector<std::unique_ptr<CustomSubscriberInfo>> infos;
+  std::vector<std::unique_ptr<SubListener>> listeners;
+  for (size_t i = 0; i < count; ++i) {
+    infos.emplace_back(new CustomSubscriberInfo());
+    listeners.emplace_back(new SubListener(infos.back().get(), 1));
+    infos.back()->listener_ = listeners.back().get();
+  }
+  // Data stays available until it is taken, so this needs to be done only once.
+  for (size_t i = 0; i < ready; ++i) {
+    listeners[i]->update_has_data(true);
+  }
+  std::vector<void *> subscribers(count);
+  rmw_subscriptions_t subscriptions{count, subscribers.data()};
+  auto fill = [&]() {
+      for (size_t i = 0; i < count; ++i) {
+        subscribers[i] = infos[i].get();
+      }
+    };
+  // The first wait attaches the entities to the wait set, only measure the next ones.
+  fill();
+  wait(st, &subscriptions, nullptr);
+
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    // rmw_wait() sets the entities which are not ready to NULL, so refill them as an executor
+    // would do.
+    fill();
+    wait(st, &subscriptions, nullptr);
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK_REGISTER_F(WaitPerformanceTest, wait_subscriptions)->Apply(wait_args);
+
+BENCHMARK_DEFINE_F(WaitPerformanceTest, wait_guard_conditions)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const size_t ready = static_cast<size_t>(st.range(1));
+  std::vector<std::unique_ptr<GuardCondition>> guard_conditions(count);
+  for (auto & guard_condition : guard_conditions) {
+    guard_condition.reset(new GuardCondition());
+  }
+  std::vector<void *> conditions(count);
+  rmw_guard_conditions_t guard_conditions_array{count, conditions.data()};
+  auto fill = [&]() {
+      for (size_t i = 0; i < count; ++i) {
+        conditions[i] = guard_conditions[i].get();
+      }
+    };
+  // The first wait attaches the entities to the wait set, only measure the next ones.
+  fill();
+  wait(st, nullptr, &guard_conditions_array);
+
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    // Triggers are consumed by waiting, so they are counted in the time measured.
+    for (size_t i = 0; i < ready; ++i) {
+      guard_conditions[i]->trigger();
+    }
+    fill();
+    wait(st, nullptr, &guard_conditions_array);
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK_REGISTER_F(WaitPerformanceTest, wait_guard_conditions)->Apply(wait_args);
@@ -0,0 +1,207 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "fastdds/dds/publisher/qos/DataWriterQos.hpp"
+#include "fastdds/dds/subscriber/qos/DataReaderQos.hpp"
+#include "fastdds/rtps/common/Guid.h"
+
+#include "rmw_fastrtps_shared_cpp/compression.hpp"
+
+using rmw_fastrtps_shared_cpp::CompressionSettings;
+using rmw_fastrtps_shared_cpp::compress_payload;
+using rmw_fastrtps_shared_cpp::decompress_payload;
+using rmw_fastrtps_shared_cpp::get_compression_settings;
+using rmw_fastrtps_shared_cpp::get_decompressed_size;
+using rmw_fastrtps_shared_cpp::is_compressed;
+using rmw_fastrtps_shared_cpp::is_compression_available;
+
+namespace
+{
+
+// A little endian CDR message with a repetitive body.
+std::vector<uint8_t>
+make_message(size_t length)
+{
+  std::vector<uint8_t> message(length);
+  message[0] = 0x00;
+  message[1] = 0x01;
+  message[2] = 0x00;
+  message[3] = 0x00;
+  for (size_t i = 4; i < length; ++i) {
+    message[i] = static_cast<uint8_t>(i % 16);
+  }
+  return message;
+}
+
+}  // namespace
+
+TEST(TestCompression, round_trip) {
+  if (!is_compression_available()) {
+    GTEST_SKIP() << "built without zstd";
+  }
+  std::vector<uint8_t> message = make_message(4096);
+  ASSERT_FALSE(is_compressed(message.data(), message.size()));
+
+  std::vector<uint8_t> buffer;
+  size_t compressed_length = 0u;
+  ASSERT_TRUE(compress_payload(message.data(), message.size(), 1, buffer, compressed_length));
+  ASSERT_LT(compressed_length, message.size());
+  ASSERT_TRUE(is_compressed(buffer.data(), compressed_length));
+  // The encapsulation is kept, so that the endianness of the message can still be told.
+  EXPECT_EQ(message[1], buffer[1]);
+
+  size_t decompressed_length = 0u;
+  ASSERT_TRUE(
+    get_decompressed_size(
+      buffer.data(), compressed_length, message.size(), decompressed_length));
+  ASSERT_EQ(message.size(), decompressed_length);
+  std::vector<uint8_t> decompressed(decompressed_length);
+  ASSERT_TRUE(
+    decompress_payload(
+      buffer.data(), compressed_length, decompressed.data(), decompressed_length));
+  EXPECT_EQ(message, decompressed);
+}
+
+TEST(TestCompression, incompressible_or_invalid) {
+  std::vector<uint8_t> buffer;
+  size_t length = 0u;
+  // Nothing to gain on messages which are that small.
+  std::vector<uint8_t> message = make_message(8);
+  EXPECT_FALSE(compress_payload(message.data(), message.size(), 1, buffer, length));
+
+  // Flagged as compressed, but not a zstd frame.
+  message = make_message(64);
+  message[2] |= rmw_fastrtps_shared_cpp::compressed_encapsulation_flag;
+  EXPECT_TRUE(is_compressed(message.data(), message.size()));
+  EXPECT_FALSE(get_decompressed_size(message.data(), message.size(), 4096u, length));
+}
+
+TEST(TestCompression, too_large) {
+  if (!is_compression_available()) {
+    GTEST_SKIP() << "built without zstd";
+  }
+  // Compresses to a few bytes, which must not be trusted to allocate the message.
+  std::vector<uint8_t> message = make_message(1024 * 1024);
+  std::vector<uint8_t> buffer;
+  size_t compressed_length = 0u;
+  ASSERT_TRUE(compress_payload(message.data(), message.size(), 1, buffer, compressed_length));
+
+  size_t decompressed_length = 0u;
+  EXPECT_FALSE(
+    get_decompressed_size(
+      buffer.data(), compressed_length, message.size() - 1u, decompressed_length));
+  EXPECT_TRUE(
+    get_decompressed_size(
+      buffer.data(), compressed_length, message.size(), decompressed_length));
+  EXPECT_EQ(message.size(), decompressed_length);
+  EXPECT_LE(rmw_fastrtps_shared_cpp::get_max_decompressed_size(), 0xFFFFFFFFu);
+}
+
+TEST(TestCompression, settings) {
+  eprosima::fastdds::dds::DataWriterQos writer_qos;
+  writer_qos.durability().kind = eprosima::fastdds::dds::VOLATILE_DURABILITY_QOS;
+  writer_qos.data_sharing().off();
+
+  CompressionSettings settings = get_compression_settings(writer_qos, 0u, "topic");
+  EXPECT_EQ(0u, settings.threshold);
+
+  writer_qos.properties().properties().emplace_back("rmw_fastrtps.compression", "zstd");
+  writer_qos.properties().properties().emplace_back(
+    "rmw_fastrtps.compression.threshold", "1024");
+  writer_qos.properties().properties().emplace_back("rmw_fastrtps.compression.level", "3");
+  settings = get_compression_settings(writer_qos, 0u, "topic");
+  if (!is_compression_available()) {
+    EXPECT_EQ(0u, settings.threshold);
+    return;
+  }
+  EXPECT_EQ(1024u, settings.threshold);
+  EXPECT_EQ(3, settings.level);
+
+  // History could be sent to late joiners which do not decompress it.
+  writer_qos.durability().kind = eprosima::fastdds::dds::TRANSIENT_LOCAL_DURABILITY_QOS;
+  settings = get_compression_settings(writer_qos, 0u, "topic");
+  EXPECT_EQ(0u, settings.threshold);
+}
+
+TEST(TestCompression, level) {
+  if (!is_compression_available()) {
+    GTEST_SKIP() << "built without zstd";
+  }
+  const std::vector<std::pair<std::string, int>> levels = {
+    {"5", 5},
+    {"-1", -1},  // zstd supports negative levels, for faster compression
+    // Rejected, so the default level is used
+    {"", 1},
+    {"fast", 1},
+    {"3x", 1},
+    {"1000", 1},
+    {"99999999999999999999", 1},
+  };
+  for (const auto & level : levels) {
+    eprosima::fastdds::dds::DataWriterQos writer_qos;
+    writer_qos.durability().kind = eprosima::fastdds::dds::VOLATILE_DURABILITY_QOS;
+    writer_qos.data_sharing().off();
+    writer_qos.properties().properties().emplace_back("rmw_fastrtps.compression", "zstd");
+    writer_qos.properties().properties().emplace_back(
+      "rmw_fastrtps.compression.level", level.first);
+    CompressionSettings settings = get_compression_settings(writer_qos, 0u, "topic");
+    EXPECT_EQ(1u, settings.threshold) << "level " << level.first;
+    EXPECT_EQ(level.second, settings.level) << "level " << level.first;
+  }
+}
+
+TEST(TestCompression, negotiation) {
+  eprosima::fastdds::dds::DataReaderQos reader_qos;
+  bool advertised = rmw_fastrtps_shared_cpp::advertise_decompression(reader_qos);
+  EXPECT_EQ(is_compression_available(), advertised);
+  EXPECT_EQ(
+    advertised,
+    rmw_fastrtps_shared_cpp::advertises_decompression(reader_qos.user_data().data_vec()));
+  rmw_fastrtps_shared_cpp::withdraw_decompression(reader_qos);
+  EXPECT_FALSE(
+    rmw_fastrtps_shared_cpp::advertises_decompression(reader_qos.user_data().data_vec()));
+
+  // Other user data set by a profile is kept
+  const std::string profile_data = "compression=zstd;other=value;";
+  reader_qos.user_data().setValue(
+    std::vector<eprosima::fastrtps::rtps::octet>(profile_data.begin(), profile_data.end()));
+  rmw_fastrtps_shared_cpp::withdraw_decompression(reader_qos);
+  const auto & user_data = reader_qos.user_data().data_vec();
+  EXPECT_EQ("other=value;", std::string(user_data.begin(), user_data.end()));
+
+  eprosima::fastrtps::rtps::GUID_t capable;
+  capable.entityId.value[3] = 1;
+  eprosima::fastrtps::rtps::GUID_t other;
+  other.entityId.value[3] = 2;
+
+  rmw_fastrtps_shared_cpp::DecompressingReaders readers;
+  readers.add(capable);
+  std::set<eprosima::fastrtps::rtps::GUID_t> matched;
+  EXPECT_FALSE(readers.contain_all(matched));
+  matched.insert(capable);
+  EXPECT_TRUE(readers.contain_all(matched));
+  matched.insert(other);
+  EXPECT_FALSE(readers.contain_all(matched));
+  readers.remove(capable);
+  matched.erase(other);
+  EXPECT_FALSE(readers.contain_all(matched));
+}
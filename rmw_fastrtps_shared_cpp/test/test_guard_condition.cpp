@@ -0,0 +1,188 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_fastrtps_shared_cpp/rmw_common.hpp"
+
+#include "types/guard_condition.hpp"
+
+using rmw_fastrtps_shared_cpp::__rmw_create_wait_set;
+using rmw_fastrtps_shared_cpp::__rmw_destroy_wait_set;
+using rmw_fastrtps_shared_cpp::__rmw_wait;
+using rmw_fastrtps_shared_cpp::__rmw_wait_set_set_spin_period;
+
+static const char * const identifier = "test_guard_condition";
+
+// Iterations of the stress tests: the given default, which is kept low enough for slow machines,
+// unless RMW_FASTRTPS_TEST_STRESS_ITERATIONS asks for more, as the long-running target does.
+static size_t
+stress_iterations(size_t default_iterations)
+{
+  const char * value = std::getenv("RMW_FASTRTPS_TEST_STRESS_ITERATIONS");
+  if (nullptr == value || '\0' == *value) {
+    return default_iterations;
+  }
+  try {
+    return static_cast<size_t>(std::stoull(value));
+  } catch (const std::exception &) {
+    ADD_FAILURE() << "invalid RMW_FASTRTPS_TEST_STRESS_ITERATIONS: " << value;
+    return default_iterations;
+  }
+}
+
+class GuardConditionTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    context.implementation_identifier = identifier;
+    wait_set = __rmw_create_wait_set(identifier, &context, 1);
+    ASSERT_NE(nullptr, wait_set);
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, __rmw_destroy_wait_set(identifier, wait_set));
+  }
+
+  // Wait for the guard condition, return whether it was triggered.
+  bool wait(GuardCondition & guard_condition, const rmw_time_t * timeout)
+  {
+    void * conditions[] = {&guard_condition};
+    rmw_guard_conditions_t guard_conditions{1, conditions};
+    rmw_ret_t ret = __rmw_wait(
+      identifier, nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, timeout);
+    EXPECT_TRUE(RMW_RET_OK == ret || RMW_RET_TIMEOUT == ret);
+    return RMW_RET_OK == ret && nullptr != conditions[0];
+  }
+
+  rmw_context_t context = rmw_get_zero_initialized_context();
+  rmw_wait_set_t * wait_set = nullptr;
+  const rmw_time_t zero_timeout{0, 0};
+  const rmw_time_t long_timeout{10, 0};
+};
+
+TEST_F(GuardConditionTest, trigger_then_wait) {
+  GuardCondition guard_condition;
+  EXPECT_FALSE(wait(guard_condition, &zero_timeout));
+  guard_condition.trigger();
+  EXPECT_TRUE(wait(guard_condition, &zero_timeout));
+  // Triggers are consumed by waiting
+  EXPECT_FALSE(wait(guard_condition, &zero_timeout));
+}
+
+TEST_F(GuardConditionTest, spin_period_is_shorter_than_two_seconds) {
+  const rmw_time_t valid[] = {{0, 0}, {0, 999999999}, {1, 999999999}};
+  for (const rmw_time_t & spin_period : valid) {
+    EXPECT_EQ(RMW_RET_OK, __rmw_wait_set_set_spin_period(identifier, wait_set, &spin_period));
+  }
+  const rmw_time_t invalid[] = {{2, 0}, {0, 1000000000}, {1, 1000000000}, {0, UINT64_MAX},
+    {UINT64_MAX, 0}};
+  for (const rmw_time_t & spin_period : invalid) {
+    EXPECT_EQ(
+      RMW_RET_INVALID_ARGUMENT,
+      __rmw_wait_set_set_spin_period(identifier, wait_set, &spin_period));
+    rmw_reset_error();
+  }
+
+  // Triggers are still seen while spinning for the period set last
+  const rmw_time_t spin_period{0, 1000000};
+  ASSERT_EQ(RMW_RET_OK, __rmw_wait_set_set_spin_period(identifier, wait_set, &spin_period));
+  GuardCondition guard_condition;
+  guard_condition.trigger();
+  EXPECT_TRUE(wait(guard_condition, &long_timeout));
+}
+
+// The waiter only goes on once it has seen the previous trigger, so that each trigger races
+// with the waiter going to sleep; a lost wake-up shows up as a timeout.
+// Each iteration may cost a context switch, so the default count is kept low.
+TEST_F(GuardConditionTest, trigger_wait_handshake) {
+  const size_t iterations = stress_iterations(20000);
+  GuardCondition guard_condition;
+  std::atomic_size_t seen{0};
+
+  std::thread trigger_thread([&guard_condition, &seen, iterations]() {
+      for (size_t i = 0; i < iterations; ++i) {
+        guard_condition.trigger();
+        while (seen.load() == i) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+  for (size_t i = 0; i < iterations; ++i) {
+    if (!wait(guard_condition, &long_timeout)) {
+      ADD_FAILURE() << "lost wake-up at iteration " << i;
+      break;
+    }
+    seen.store(i + 1);
+  }
+  seen.store(iterations);
+  trigger_thread.join();
+}
+
+// Several threads trigger concurrently while the waiter keeps waiting; the last trigger must
+// always be seen.
+TEST_F(GuardConditionTest, concurrent_triggers) {
+  constexpr size_t thread_count = 4;
+  const size_t iterations = stress_iterations(100000);
+  GuardCondition guard_condition;
+  GuardCondition done;
+  std::atomic_size_t running{thread_count};
+
+  std::vector<std::thread> trigger_threads;
+  for (size_t t = 0; t < thread_count; ++t) {
+    trigger_threads.emplace_back(
+      [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+          guard_condition.trigger();
+        }
+        if (--running == 0) {
+          done.trigger();
+        }
+      });
+  }
+
+  bool finished = false;
+  while (!finished) {
+    void * conditions[] = {&guard_condition, &done};
+    rmw_guard_conditions_t guard_conditions{2, conditions};
+    ASSERT_EQ(
+      RMW_RET_OK,
+      __rmw_wait(
+        identifier, nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set,
+        &long_timeout));
+    finished = nullptr != conditions[1];
+  }
+  for (auto & trigger_thread : trigger_threads) {
+    trigger_thread.join();
+  }
+
+  // Nothing pending anymore, and a new trigger is still seen
+  EXPECT_FALSE(wait(guard_condition, &zero_timeout));
+  guard_condition.trigger();
+  EXPECT_TRUE(wait(guard_condition, &long_timeout));
+}
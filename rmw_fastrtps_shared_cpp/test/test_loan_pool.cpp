@@ -0,0 +1,178 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "types/loan_pool.hpp"
+
+using eprosima::fastrtps::ResourceLimitedContainerConfig;
+
+namespace
+{
+
+struct Item
+{
+  void * loaned_message{nullptr};
+};
+
+// Messages are the home bucket they must be hashed to.
+struct HomeBucketHash
+{
+  size_t operator()(const void * loaned_message) const
+  {
+    return *static_cast<const size_t *>(loaned_message);
+  }
+};
+
+template<typename PoolT>
+Item *
+loan(PoolT & pool, void * message)
+{
+  Item * item = pool.get_item();
+  if (nullptr != item) {
+    item->loaned_message = message;
+    pool.add_item(item);
+  }
+  return item;
+}
+
+}  // namespace
+
+TEST(LoanPoolTest, interleaved_take_and_return) {
+  LoanPool<Item> pool(ResourceLimitedContainerConfig(2u, 16u, 2u));
+  std::vector<int> messages(16);
+  std::vector<Item *> items(messages.size(), nullptr);
+
+  for (size_t round = 0; round < 10; ++round) {
+    // Take them all, returning every third one right away
+    for (size_t i = 0; i < messages.size(); ++i) {
+      items[i] = loan(pool, &messages[i]);
+      ASSERT_NE(nullptr, items[i]);
+      if (i % 3 == round % 3) {
+        EXPECT_EQ(items[i], pool.erase_item(&messages[i]));
+        pool.release_item(items[i]);
+        items[i] = nullptr;
+      }
+    }
+    // Items are not handed out twice
+    std::set<Item *> outstanding;
+    for (Item * item : items) {
+      if (nullptr != item) {
+        EXPECT_TRUE(outstanding.insert(item).second);
+      }
+    }
+    // Return the others, last first
+    for (size_t i = messages.size(); i-- > 0; ) {
+      if (nullptr != items[i]) {
+        EXPECT_EQ(items[i], pool.erase_item(&messages[i]));
+        EXPECT_EQ(nullptr, pool.erase_item(&messages[i]));
+        pool.release_item(items[i]);
+      }
+    }
+  }
+
+  int not_loaned = 0;
+  EXPECT_EQ(nullptr, pool.erase_item(&not_loaned));
+}
+
+TEST(LoanPoolTest, colliding_keys) {
+  // Four items, so an index of eight buckets
+  LoanPool<Item, HomeBucketHash> pool(ResourceLimitedContainerConfig(4u, 4u, 1u));
+  std::vector<size_t> messages = {3u, 3u, 3u, 3u};
+  std::vector<Item *> items;
+  for (size_t & message : messages) {
+    items.push_back(loan(pool, &message));
+    ASSERT_NE(nullptr, items.back());
+  }
+
+  size_t not_loaned = 3u;
+  EXPECT_EQ(nullptr, pool.erase_item(&not_loaned));
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_EQ(items[i], pool.erase_item(&messages[i]));
+  }
+}
+
+TEST(LoanPoolTest, erase_in_the_middle_of_a_probe_chain) {
+  LoanPool<Item, HomeBucketHash> pool(ResourceLimitedContainerConfig(4u, 4u, 1u));
+
+  // Homes 7, 7 and 0 are stored at 7, 0 and 1: both following items are shifted back.
+  {
+    std::vector<size_t> messages = {7u, 7u, 0u};
+    std::vector<Item *> items;
+    for (size_t & message : messages) {
+      items.push_back(loan(pool, &message));
+    }
+    EXPECT_EQ(items[0], pool.erase_item(&messages[0]));
+    pool.release_item(items[0]);
+    EXPECT_EQ(items[2], pool.erase_item(&messages[2]));
+    pool.release_item(items[2]);
+    EXPECT_EQ(items[1], pool.erase_item(&messages[1]));
+    pool.release_item(items[1]);
+  }
+
+  // Homes 6, 7 and 7 are stored at 6, 7 and 0: none of them can be shifted back to 6.
+  {
+    std::vector<size_t> messages = {6u, 7u, 7u};
+    std::vector<Item *> items;
+    for (size_t & message : messages) {
+      items.push_back(loan(pool, &message));
+    }
+    EXPECT_EQ(items[0], pool.erase_item(&messages[0]));
+    pool.release_item(items[0]);
+    EXPECT_EQ(items[2], pool.erase_item(&messages[2]));
+    pool.release_item(items[2]);
+    EXPECT_EQ(items[1], pool.erase_item(&messages[1]));
+    pool.release_item(items[1]);
+  }
+
+  // Homes 1, 2, 1 and 2 are stored at 1, 2, 3 and 4: erasing the second one moves the third
+  // one and then the fourth one.
+  {
+    std::vector<size_t> messages = {1u, 2u, 1u, 2u};
+    std::vector<Item *> items;
+    for (size_t & message : messages) {
+      items.push_back(loan(pool, &message));
+    }
+    EXPECT_EQ(items[1], pool.erase_item(&messages[1]));
+    EXPECT_EQ(nullptr, pool.erase_item(&messages[1]));
+    EXPECT_EQ(items[3], pool.erase_item(&messages[3]));
+    EXPECT_EQ(items[0], pool.erase_item(&messages[0]));
+    EXPECT_EQ(items[2], pool.erase_item(&messages[2]));
+  }
+}
+
+TEST(LoanPoolTest, maximum_outstanding_loans) {
+  LoanPool<Item> pool(ResourceLimitedContainerConfig(1u, 3u, 1u));
+  std::vector<int> messages(4);
+  std::vector<Item *> items;
+  for (size_t i = 0; i < 3; ++i) {
+    items.push_back(loan(pool, &messages[i]));
+    ASSERT_NE(nullptr, items.back());
+  }
+  // The rmw reports "Too many outstanding loans" for this one
+  EXPECT_EQ(nullptr, pool.get_item());
+
+  EXPECT_EQ(items[1], pool.erase_item(&messages[1]));
+  pool.release_item(items[1]);
+  EXPECT_EQ(items[1], loan(pool, &messages[3]));
+  EXPECT_EQ(nullptr, pool.get_item());
+
+  EXPECT_EQ(items[0], pool.erase_item(&messages[0]));
+  EXPECT_EQ(items[1], pool.erase_item(&messages[3]));
+  EXPECT_EQ(items[2], pool.erase_item(&messages[2]));
+}
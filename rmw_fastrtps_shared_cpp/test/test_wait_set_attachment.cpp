@@ -0,0 +1,252 @@
+// Copyright 2022 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "rmw_fastrtps_shared_cpp/wait_set_attachment.hpp"
+
+using rmw_fastrtps_shared_cpp::WaitSetAttachment;
+using rmw_fastrtps_shared_cpp::WaitSetReadyQueue;
+
+TEST(WaitSetReadyQueueTest, push_take) {
+  WaitSetReadyQueue queue;
+  WaitSetReadyQueue::Node first, second;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(nullptr, queue.take_all());
+
+  queue.push(&first);
+  queue.push(&second);
+  // Already queued nodes are not pushed twice
+  queue.push(&first);
+  EXPECT_FALSE(queue.empty());
+
+  WaitSetReadyQueue::Node * node = queue.take_all();
+  EXPECT_TRUE(queue.empty());
+  ASSERT_EQ(&second, node);
+  ASSERT_EQ(&first, node->next);
+  EXPECT_EQ(nullptr, node->next->next);
+
+  // Not released yet
+  queue.push(&first);
+  EXPECT_TRUE(queue.empty());
+
+  WaitSetReadyQueue::release(&first);
+  queue.push(&first);
+  EXPECT_EQ(&first, queue.take_all());
+}
+
+TEST(WaitSetReadyQueueTest, concurrent_push) {
+  constexpr size_t node_count = 64;
+  constexpr size_t iterations = 10000;
+  WaitSetReadyQueue queue;
+  std::vector<WaitSetReadyQueue::Node> nodes(node_count);
+
+  std::vector<std::thread> producers;
+  for (size_t t = 0; t < 4; ++t) {
+    producers.emplace_back(
+      [&queue, &nodes]() {
+        for (size_t i = 0; i < iterations; ++i) {
+          queue.push(&nodes[i % nodes.size()]);
+        }
+      });
+  }
+
+  std::set<WaitSetReadyQueue::Node *> taken;
+  auto take = [&queue, &taken]() {
+      WaitSetReadyQueue::Node * node = queue.take_all();
+      while (nullptr != node) {
+        WaitSetReadyQueue::Node * next = node->next;
+        WaitSetReadyQueue::release(node);
+        taken.insert(node);
+        node = next;
+      }
+    };
+  while (taken.size() < node_count) {
+    take();
+  }
+  for (auto & producer : producers) {
+    producer.join();
+  }
+  take();
+  EXPECT_EQ(node_count, taken.size());
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(WaitSetReadyQueueTest, wait_until) {
+  WaitSetReadyQueue queue;
+  WaitSetReadyQueue::Node node;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+  EXPECT_FALSE(queue.wait_until(deadline));
+
+  std::thread producer([&queue, &node]() {queue.push(&node);});
+  queue.wait();
+  producer.join();
+  EXPECT_EQ(&node, queue.take_all());
+}
+
+TEST(WaitSetAttachmentTest, notify_pushes_when_attached) {
+  WaitSetReadyQueue queue;
+  WaitSetReadyQueue::Node node;
+  node.queue = &queue;
+  WaitSetAttachment attachment;
+
+  attachment.notify();
+  EXPECT_TRUE(queue.empty());
+
+  attachment.attach(&node);
+  EXPECT_TRUE(attachment.is_attached_to(&queue));
+  attachment.notify();
+  EXPECT_EQ(&node, queue.take_all());
+  WaitSetReadyQueue::release(&node);
+
+  // Detaching from another wait set has no effect
+  WaitSetReadyQueue other_queue;
+  attachment.detach(&other_queue);
+  EXPECT_TRUE(attachment.is_attached_to(&queue));
+
+  attachment.detach(&queue);
+  EXPECT_FALSE(attachment.is_attached_to(&queue));
+  attachment.notify();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(WaitSetAttachmentTest, several_wait_sets) {
+  // More than fit in a block of slots
+  constexpr size_t wait_set_count = 2 * WaitSetAttachment::slots_per_block + 1;
+  std::vector<WaitSetReadyQueue> queues(wait_set_count);
+  std::vector<WaitSetReadyQueue::Node> nodes(wait_set_count);
+  WaitSetAttachment attachment;
+  for (size_t i = 0; i < wait_set_count; ++i) {
+    nodes[i].queue = &queues[i];
+    attachment.attach(&nodes[i]);
+  }
+
+  // None of them is detached, so none of their waiters can miss a notification
+  attachment.notify();
+  for (size_t i = 0; i < wait_set_count; ++i) {
+    EXPECT_TRUE(attachment.is_attached_to(&queues[i]));
+    EXPECT_EQ(&nodes[i], queues[i].take_all());
+    WaitSetReadyQueue::release(&nodes[i]);
+  }
+
+  // Freed slots are reused
+  attachment.detach(&queues[3]);
+  EXPECT_FALSE(attachment.is_attached_to(&queues[3]));
+  WaitSetReadyQueue extra_queue;
+  WaitSetReadyQueue::Node extra_node;
+  extra_node.queue = &extra_queue;
+  attachment.attach(&extra_node);
+  attachment.notify();
+  EXPECT_EQ(&extra_node, extra_queue.take_all());
+  EXPECT_TRUE(queues[3].empty());
+  for (size_t i = 0; i < wait_set_count; ++i) {
+    if (3 != i) {
+      EXPECT_TRUE(attachment.is_attached_to(&queues[i]));
+      EXPECT_EQ(&nodes[i], queues[i].take_all());
+    }
+  }
+}
+
+TEST(WaitSetAttachmentTest, blocked_waiter_woken_with_many_wait_sets) {
+  constexpr size_t wait_set_count = WaitSetAttachment::slots_per_block + 1;
+  std::vector<WaitSetReadyQueue> queues(wait_set_count);
+  std::vector<WaitSetReadyQueue::Node> nodes(wait_set_count);
+  WaitSetAttachment attachment;
+  nodes[0].queue = &queues[0];
+  attachment.attach(&nodes[0]);
+
+  // The first wait set blocks without a timeout while the others attach
+  std::thread waiter([&queues]() {queues[0].wait();});
+  for (size_t i = 1; i < wait_set_count; ++i) {
+    nodes[i].queue = &queues[i];
+    attachment.attach(&nodes[i]);
+  }
+  attachment.notify();
+  waiter.join();
+  EXPECT_EQ(&nodes[0], queues[0].take_all());
+}
+
+TEST(WaitSetAttachmentTest, detach_while_notifying) {
+  WaitSetAttachment attachment;
+  std::atomic_bool stop{false};
+  std::thread notifier([&attachment, &stop]() {
+      while (!stop) {
+        attachment.notify();
+      }
+    });
+
+  for (size_t i = 0; i < 1000; ++i) {
+    WaitSetReadyQueue queue;
+    {
+      WaitSetReadyQueue::Node node;
+      node.queue = &queue;
+      attachment.attach(&node);
+      attachment.detach(&queue);
+    }
+    // The node is gone, it must not have been pushed after detaching
+    while (!queue.empty()) {
+      queue.take_all();
+    }
+  }
+  stop = true;
+  notifier.join();
+}
+
+TEST(WaitSetAttachmentTest, notify_only_when_became_ready) {
+  WaitSetReadyQueue queue;
+  WaitSetReadyQueue::Node node;
+  node.queue = &queue;
+  WaitSetAttachment attachment;
+  attachment.attach(&node);
+
+  attachment.notify_if_became_ready(false);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(1u, queue.suppressed_notifications());
+
+  attachment.notify_if_became_ready(true);
+  EXPECT_FALSE(queue.empty());
+  EXPECT_EQ(1u, queue.suppressed_notifications());
+  attachment.detach(&queue);
+}
+
+TEST(WaitSetAttachmentTest, suppressed_notifications_counted_per_wait_set) {
+  WaitSetReadyQueue first_queue, second_queue;
+  WaitSetReadyQueue::Node first_node, second_node;
+  first_node.queue = &first_queue;
+  second_node.queue = &second_queue;
+  WaitSetAttachment attachment;
+
+  // Not attached yet, nobody counts it
+  attachment.notify_if_became_ready(false);
+
+  attachment.attach(&first_node);
+  attachment.notify_if_became_ready(false);
+  attachment.attach(&second_node);
+  attachment.notify_if_became_ready(false);
+  attachment.detach(&first_queue);
+  attachment.notify_if_became_ready(false);
+  attachment.detach(&second_queue);
+  attachment.notify_if_became_ready(false);
+
+  EXPECT_EQ(2u, first_queue.suppressed_notifications());
+  EXPECT_EQ(2u, second_queue.suppressed_notifications());
+  EXPECT_TRUE(first_queue.empty());
+  EXPECT_TRUE(second_queue.empty());
+}